@@ -0,0 +1,117 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#include <wws.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLES() (__rdtsc())
+#else
+#define CYCLES() (0ULL)
+#endif /** x86 */
+
+#define BUF_SIZE   (4096U)
+#define ROUNDS     (4096U)
+#define DB_SIZE    (1024U)
+#define DB_STORAGE (4096U)
+#define DB_ROUNDS  (1024U)
+
+static const char *const impl_name[] = { "bitwise", "table", "slice8" };
+
+static unsigned char buf[BUF_SIZE];
+
+static volatile unsigned int sink;
+
+typedef struct
+{
+  unsigned long long ns;
+  unsigned long long cycles;
+} measure_t;
+
+static unsigned long long now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long) ts.tv_sec * 1000000000ULL + (unsigned long long) ts.tv_nsec;
+}
+
+static void report(const char *name, unsigned long long bytes, measure_t m)
+{
+  const double ns = m.ns ? (double) m.ns : 1.0;
+  printf("%-8s %-8s %8.1f MB/s", impl_name[WWS_CONFIG_CRC_IMPL], name, bytes * 1000.0 / ns);
+  if (m.cycles) printf(" %6.3f bytes/cycle", (double) bytes / (double) m.cycles);
+  printf("\r\n");
+}
+
+#define MEASURE(_m, _body)                                                                         \
+  do {                                                                                             \
+    unsigned long long _ns = now_ns(), _cy = CYCLES();                                             \
+    _body;                                                                                         \
+    (_m).cycles = CYCLES() - _cy;                                                                  \
+    (_m).ns     = now_ns() - _ns;                                                                  \
+  } while (0)
+
+static struct
+{
+  unsigned int head;
+  char         data[DB_SIZE];
+  unsigned int tail;
+} image;
+
+/**
+ * @brief load of crc protected database from simulated memory, dominated by crc of data
+ */
+static void bench_load(void)
+{
+  static char      storage[DB_STORAGE];
+  wws_memory_sim_t sim = { .data = storage, .size = DB_STORAGE };
+  wws_database_t   db  = {
+       .key    = 0xC0FFEE,
+       .head   = &image.head,
+       .tail   = &image.tail,
+       .memory = { .interface = (wws_memory_inf_t *) &wws_memory_sim_interface,
+                   .inst      = &sim,
+                   .size      = DB_STORAGE },
+       .crc    = 1,
+  };
+  measure_t m = { 0 };
+
+  memset(storage, 0xFF, DB_STORAGE);
+  memcpy(image.data, buf, DB_SIZE);
+  wws_database_load(&db);
+  memcpy(image.data, buf, DB_SIZE);
+  wws_database_save(&db);
+
+  MEASURE(m, for (unsigned int r = 0; r < DB_ROUNDS; r++) {
+    if (wws_database_load(&db) != WWS_RET_OK) {
+      printf("load failed\r\n");
+      return;
+    }
+  });
+  report("load", (unsigned long long) DB_SIZE * DB_ROUNDS, m);
+}
+
+int main(int argc, char const *argv[])
+{
+  const unsigned long long bytes = (unsigned long long) BUF_SIZE * ROUNDS;
+  measure_t                m     = { 0 };
+
+  for (unsigned int i = 0; i < BUF_SIZE; i++) buf[i] = (unsigned char) (i * 131 + 7);
+
+  MEASURE(m, for (unsigned int r = 0; r < ROUNDS; r++) sink = wws_crc8(buf, BUF_SIZE));
+  report("crc8", bytes, m);
+  MEASURE(m, for (unsigned int r = 0; r < ROUNDS; r++) sink = wws_crc16(buf, BUF_SIZE));
+  report("crc16", bytes, m);
+  MEASURE(m, for (unsigned int r = 0; r < ROUNDS; r++) sink = wws_crc32(buf, BUF_SIZE));
+  report("crc32", bytes, m);
+
+  bench_load();
+  return 0;
+}
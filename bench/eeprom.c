@@ -0,0 +1,141 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#include <wws.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define CELLS      (16U * 1024U)
+#define WRITE_SIZE (1024U)
+#define DB_BASE    (4096U)
+#define DB_REGION  (2048U)
+#define DB_SIZE    (500U)
+#define DB_PAGE    (64U)
+#define DB_ROUNDS  (100U)
+
+static unsigned char cells[CELLS];
+static unsigned int  wear[CELLS];
+
+static wws_eeprom_sim_t sim = {
+  .schema = &wws_eeprom_AT24C128, .data = cells, .wear = wear, .tick = 1
+};
+static wws_i2c_t    bus    = { .interface = (wws_i2c_inf_t *) &wws_eeprom_sim_interface,
+                               .inst      = &sim };
+static wws_eeprom_t eeprom = { .schema = &wws_eeprom_AT24C128, .bus = &bus };
+
+typedef struct
+{
+  unsigned long long elapsed;
+  unsigned int       cycles;
+} mark_t;
+
+static mark_t mark(void)
+{
+  return (mark_t){ .elapsed = sim.elapsed, .cycles = sim.cycles };
+}
+
+static unsigned int wear_max(unsigned int from, unsigned int len)
+{
+  unsigned int max = 0;
+  for (unsigned int i = from; i < (from + len); i++) {
+    if (wear[i] > max) max = wear[i];
+  }
+  return max;
+}
+
+static void report(const char *name, mark_t from, unsigned int rounds, unsigned int max)
+{
+  const mark_t to = mark();
+  printf("%-24s %10.3f ms/op %8.2f cycles/op  max wear %u\r\n",
+         name,
+         (double) (to.elapsed - from.elapsed) / 1e6 / rounds,
+         (double) (to.cycles - from.cycles) / rounds,
+         max);
+}
+
+/**
+ * @brief blocking writes: aligned, unaligned, and single bytes
+ */
+static void bench_write(void)
+{
+  static unsigned char data[WRITE_SIZE];
+  unsigned int         written = 0;
+  mark_t               m       = { 0 };
+
+  for (unsigned int i = 0; i < WRITE_SIZE; i++) data[i] = (unsigned char) (i * 3);
+
+  memset(wear, 0, sizeof(wear));
+  m = mark();
+  wws_eeprom_write(&eeprom, 0, data, WRITE_SIZE, &written);
+  report("write 1KB aligned", m, 1, wear_max(0, CELLS));
+
+  memset(wear, 0, sizeof(wear));
+  m = mark();
+  wws_eeprom_write(&eeprom, 10, data, WRITE_SIZE, &written);
+  report("write 1KB unaligned", m, 1, wear_max(0, CELLS));
+
+  memset(wear, 0, sizeof(wear));
+  m = mark();
+  for (unsigned int i = 0; i < 64; i++) wws_eeprom_write(&eeprom, i * 7, &data[i], 1, &written);
+  report("write 1B x64", m, 64, wear_max(0, CELLS));
+}
+
+static struct
+{
+  unsigned int head;
+  char         data[DB_SIZE];
+  unsigned int tail;
+} image;
+
+static unsigned int hashes[(DB_SIZE + 8) / DB_PAGE + 1];
+
+/**
+ * @brief database save of one changed byte per round, whole image vs changed pages vs A/B
+ */
+static void bench_database(const char *name, unsigned short page_size, bool ab)
+{
+  wws_database_t db = {
+    .key       = 0xBEEF,
+    .head      = &image.head,
+    .tail      = &image.tail,
+    .memory    = { .interface = (wws_memory_inf_t *) &wws_eeprom_memory_interface,
+                   .inst      = &eeprom,
+                   .base      = DB_BASE,
+                   .size      = DB_REGION },
+    .page_size = page_size,
+    .hashes    = page_size ? hashes : 0,
+    .crc       = 1,
+    .ab        = ab,
+  };
+  mark_t m = { 0 };
+
+  memset(&cells[DB_BASE], 0xFF, DB_REGION);
+  memset(&image, 0, sizeof(image));
+  wws_database_load(&db);
+
+  memset(wear, 0, sizeof(wear));
+  m = mark();
+  for (unsigned int r = 0; r < DB_ROUNDS; r++) {
+    image.data[(r * 37) % DB_SIZE]++;
+    if (wws_database_save(&db) != WWS_RET_OK) {
+      printf("%s: save failed\r\n", name);
+      return;
+    }
+  }
+  report(name, m, DB_ROUNDS, wear_max(DB_BASE, DB_REGION));
+}
+
+int main(int argc, char const *argv[])
+{
+  memset(cells, 0xFF, sizeof(cells));
+
+  bench_write();
+  bench_database("database save whole", 0, false);
+  bench_database("database save pages", DB_PAGE, false);
+  bench_database("database save A/B", 0, true);
+  return 0;
+}
@@ -0,0 +1,176 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+/** pin access cost of the model, measured at run time */
+static unsigned int pin_cycles;
+#define WWS_CONFIG_I2C_SOFT_PIN_CYCLES pin_cycles
+/** a loop as a cycle keeps equivalent cpu clock of host in range */
+#define WWS_CONFIG_DELAY_LOOP_CYCLES (1U)
+
+#include <wws.h>
+
+#include <stdio.h>
+#include <time.h>
+
+#define PAYLOAD (64U)
+#define PROBE   (1000U)
+/** deviation of bus clock from target accepted, in percent */
+#define TOLERANCE (10U)
+
+/**
+ * @brief pin model: open-drain lines, slave acks every byte, SCL phases timed
+ */
+static struct
+{
+  wws_logic_t        scl, sda_master, sda_slave;
+  unsigned int       bits;
+  unsigned long long rise, fall;
+  unsigned long long low_min, high_min, low_sum, high_sum;
+  unsigned int       lows, highs;
+} pins;
+
+static unsigned long long now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long) ts.tv_sec * 1000000000ULL + (unsigned long long) ts.tv_nsec;
+}
+
+static wws_logic_t sda_line(void)
+{
+  return ((pins.sda_master == WWS_HIGH) && (pins.sda_slave == WWS_HIGH)) ? WWS_HIGH : WWS_LOW;
+}
+
+static void scl_write(wws_logic_t logic, void *inst)
+{
+  const unsigned long long t = now_ns();
+
+  if ((pins.scl == WWS_LOW) && (logic == WWS_HIGH)) {
+    if (pins.fall) {
+      const unsigned long long l = t - pins.fall;
+      if (l < pins.low_min) pins.low_min = l;
+      pins.low_sum += l;
+      pins.lows++;
+    }
+    pins.rise = t;
+    pins.bits++;
+  }
+  if ((pins.scl == WWS_HIGH) && (logic == WWS_LOW)) {
+    if (pins.rise) {
+      const unsigned long long h = t - pins.rise;
+      if (h < pins.high_min) pins.high_min = h;
+      pins.high_sum += h;
+      pins.highs++;
+    }
+    pins.fall = t;
+    /** ack driven after 8th clock, released after 9th */
+    if (pins.bits == 8) pins.sda_slave = WWS_LOW;
+    if (pins.bits == 9) {
+      pins.sda_slave = WWS_HIGH;
+      pins.bits      = 0;
+    }
+  }
+  pins.scl = logic;
+}
+
+static void sda_write(wws_logic_t logic, void *inst)
+{
+  const wws_logic_t before = sda_line();
+
+  pins.sda_master = logic;
+  /** start resets bit count */
+  if ((pins.scl == WWS_HIGH) && (before == WWS_HIGH) && (sda_line() == WWS_LOW)) pins.bits = 0;
+}
+
+static wws_logic_t sda_read(void *inst)
+{
+  return sda_line();
+}
+
+static wws_logic_writer_t scl    = { .write = scl_write };
+static wws_logic_writer_t sda    = { .write = sda_write };
+static wws_logic_reader_t sda_in = { .read = sda_read };
+
+/**
+ * @brief write payload with delay loops, pin phases collected
+ */
+static wws_ret_t run(unsigned int loops_low, unsigned int loops_high)
+{
+  wws_i2c_soft_t soft = {
+    .scl = &scl, .sda = &sda, .sda_in = &sda_in, .loops_low = loops_low, .loops_high = loops_high
+  };
+  wws_i2c_t     i2c  = { .interface = (wws_i2c_inf_t *) &wws_i2c_soft_interface, .inst = &soft };
+  unsigned char data[PAYLOAD] = { 0 };
+
+  pins = (__typeof__(pins)){ .scl        = WWS_HIGH,
+                             .sda_master = WWS_HIGH,
+                             .sda_slave  = WWS_HIGH,
+                             .low_min    = ~0ULL,
+                             .high_min   = ~0ULL };
+  return wws_i2c_xfer(
+    &i2c,
+    0x50,
+    (wws_i2c_xfer_t[]){ { .cptr = data, .size = PAYLOAD, .xfer = WWS_XFER_WRITE }, {} },
+    WWS_MS(100));
+}
+
+/**
+ * @brief run at loops configured for bus clock, phases against minimum of spec
+ * @note clock taken from fastest phases, as the loops time them; mean includes preemption of host
+ */
+static void
+bench(unsigned int cpu_hz, unsigned int bus_hz, unsigned int low_min, unsigned int high_min)
+{
+  const wws_i2c_soft_t cfg  = { WWS_I2C_SOFT_TIMING(cpu_hz, bus_hz) };
+  const wws_ret_t      ret  = run(cfg.loops_low, cfg.loops_high);
+  const double         low  = (double) pins.low_sum / pins.lows;
+  const double         high = (double) pins.high_sum / pins.highs;
+  const double         rate = 1e9 / (double) (pins.low_min + pins.high_min);
+  const double         off  = 100.0 * (rate - bus_hz) / bus_hz;
+
+  printf("%6u Hz, loops %u/%u: xfer %s, %.1f kHz (%+.0f%% %s), mean %.1f kHz, "
+         "tLOW %.0f (min %llu, spec %u %s) ns, tHIGH %.0f (min %llu, spec %u %s) ns\r\n",
+         bus_hz,
+         cfg.loops_low,
+         cfg.loops_high,
+         ret,
+         rate / 1e3,
+         off,
+         ((off >= -(double) TOLERANCE) && (off <= TOLERANCE)) ? "ok" : "FAIL",
+         1e6 / (low + high),
+         low,
+         pins.low_min,
+         low_min,
+         pins.low_min >= low_min ? "ok" : "VIOLATED",
+         high,
+         pins.high_min,
+         high_min,
+         pins.high_min >= high_min ? "ok" : "VIOLATED");
+}
+
+int main(int argc, char const *argv[])
+{
+  /**
+   * delay loop and pin access of host by two runs, expressed as cycles of an equivalent cpu,
+   * fastest phases taken since loop speed of host varies (store forwarding, frequency scaling)
+   */
+  run(PROBE, PROBE);
+  run(0, 0);
+  const double pin_ns = (double) pins.low_min;
+  run(PROBE, PROBE);
+  const double       loop_ns = ((double) pins.low_min - pin_ns) / PROBE;
+  const unsigned int cpu_hz  = (unsigned int) (WWS_CONFIG_DELAY_LOOP_CYCLES * 1e9 / loop_ns);
+  pin_cycles                 = (unsigned int) (pin_ns * cpu_hz / 1e9 + 0.5);
+
+  printf("host: delay loop %.2f ns as %u Hz cpu, pin access of phase %.0f ns (%u cycles)\r\n",
+         loop_ns,
+         cpu_hz,
+         pin_ns,
+         pin_cycles);
+  bench(cpu_hz, 400000, 1300, 600);
+  bench(cpu_hz, 100000, 4700, 4000);
+  return 0;
+}
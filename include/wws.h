@@ -15,27 +15,36 @@
 
 #include "wws_mcu/byte.h"
 #include "wws_mcu/data.h"
+#include "wws_mcu/crc.h"
 #include "wws_mcu/logic.h"
 #include "wws_mcu/ringbuffer.h"
 #include "wws_mcu/countdown.h"
 #include "wws_mcu/memory.h"
+#include "wws_mcu/memory_cache.h"
+#include "wws_mcu/memory_sim.h"
 #include "wws_mcu/manifest.h"
 
 #include "wws_mcu/service.h"
 #include "wws_mcu/tick.h"
 
 #include "wws_mcu/i2c.h"
+#include "wws_mcu/i2c_bus.h"
+#include "wws_mcu/i2c_soft.h"
 #include "wws_mcu/spi.h"
 
 #include "wws_mcu/state_machine.h"
 #include "wws_mcu/cli.h"
+#include "wws_mcu/i2c_cli.h"
 #include "wws_mcu/database.h"
+#include "wws_mcu/journal.h"
+#include "wws_mcu/kv.h"
 #include "wws_mcu/logic_filter.h"
 #include "wws_mcu/button.h"
 
 #include "wws_mcu/aw9523b.h"
 #include "wws_mcu/encoder.h"
 #include "wws_mcu/eeprom.h"
+#include "wws_mcu/eeprom_sim.h"
 #include "wws_mcu/ir.h"
 
 #endif /* ___WWS_WWS_H___ */
@@ -108,6 +108,17 @@ extern wws_ret_t wws_byte_write_str(wws_byte_t *b, const char *str);
 extern wws_ret_t
 wws_byte_put_repeat(wws_byte_t *b, char byte, unsigned int times, unsigned int *written);
 
+/**
+ * @brief write unsigned number, right aligned
+ * @param b
+ * @param value
+ * @param base 2 to 16, digits in upper case
+ * @param width min length, padded by @p pad on the left
+ * @param pad
+ */
+extern wws_ret_t wws_byte_write_uint(
+  wws_byte_t *b, unsigned int value, unsigned int base, unsigned int width, char pad);
+
 /**
  * @brief reset rx buffer
  * @param b
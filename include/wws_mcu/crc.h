@@ -0,0 +1,87 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#ifndef ___WWS_CRC_H___
+#define ___WWS_CRC_H___
+
+#include "typedef.h"
+
+/**
+ * @brief implementations
+ * - WWS_CRC_BITWISE: no table, smallest and slowest
+ * - WWS_CRC_TABLE: 256-entry table per crc
+ * - WWS_CRC_SLICE8: crc32 in 8 bytes per step with 8 tables (8KB), others as table
+ */
+#define WWS_CRC_BITWISE (0)
+#define WWS_CRC_TABLE   (1)
+#define WWS_CRC_SLICE8  (2)
+
+/**
+ * @brief Config implementation of crc
+ */
+#ifndef WWS_CONFIG_CRC_IMPL
+#define WWS_CONFIG_CRC_IMPL WWS_CRC_TABLE
+#endif /** WWS_CONFIG_CRC_IMPL */
+
+/**
+ * @brief initial values
+ */
+#define WWS_CRC8_INIT  (0x00U)
+#define WWS_CRC16_INIT (0xFFFFU)
+#define WWS_CRC32_INIT (0x00000000U)
+
+/**
+ * @brief update CRC-8 (poly 0x07, SMBus)
+ * @param crc WWS_CRC8_INIT or previous result
+ * @param data
+ * @param len
+ * @return crc
+ */
+extern unsigned char wws_crc8_update(unsigned char crc, const void *data, unsigned int len);
+
+/**
+ * @brief update CRC-16 (poly 0x1021, CCITT-FALSE)
+ * @param crc WWS_CRC16_INIT or previous result
+ * @param data
+ * @param len
+ * @return crc
+ */
+extern unsigned short wws_crc16_update(unsigned short crc, const void *data, unsigned int len);
+
+/**
+ * @brief update CRC-32 (poly 0xEDB88320, IEEE 802.3)
+ * @param crc WWS_CRC32_INIT or previous result
+ * @param data
+ * @param len
+ * @return crc
+ */
+extern unsigned int wws_crc32_update(unsigned int crc, const void *data, unsigned int len);
+
+/**
+ * @brief CRC-8 of data
+ */
+static inline unsigned char wws_crc8(const void *data, unsigned int len)
+{
+  return wws_crc8_update(WWS_CRC8_INIT, data, len);
+}
+
+/**
+ * @brief CRC-16 of data
+ */
+static inline unsigned short wws_crc16(const void *data, unsigned int len)
+{
+  return wws_crc16_update(WWS_CRC16_INIT, data, len);
+}
+
+/**
+ * @brief CRC-32 of data
+ */
+static inline unsigned int wws_crc32(const void *data, unsigned int len)
+{
+  return wws_crc32_update(WWS_CRC32_INIT, data, len);
+}
+
+#endif /* ___WWS_CRC_H___ */
@@ -12,6 +12,8 @@
 
 extern wws_comp_t WWS_COMP_DATABASE;
 extern wws_evt_t  WWS_EVT_INVALID;
+extern wws_evt_t  WWS_EVT_DONE;
+extern wws_evt_t  WWS_EVT_MIGRATE;
 extern wws_ret_t  WWS_RET_OK;
 
 /**
@@ -24,10 +26,33 @@ extern wws_ret_t WWS_RET_REINIT;
  */
 #define WWS_DB(_name) WWS_RAM("db." #_name)
 
+typedef struct __wws_database_t wws_database_t;
+
+/**
+ * @brief migration from image of old version, array terminated by size 0
+ */
+typedef struct __wws_database_migration_t
+{
+  /**
+   * @brief version of old image
+   */
+  unsigned short version;
+  /**
+   * @brief data size of old image
+   */
+  unsigned int size;
+  /**
+   * @brief transform data in RAM from old image (optional)
+   * @note data is pre-filled with common prefix of old image, rest remains default
+   * @note return other than WWS_RET_OK to discard old image (re-init from defaults)
+   */
+  wws_ret_t (*migrate)(wws_database_t *db, wws_memory_t *old);
+} wws_database_migration_t;
+
 /**
  * @brief database definition
  */
-typedef struct __wws_database_t
+struct __wws_database_t
 {
   /**
    * @brief key as magic to validate
@@ -46,15 +71,80 @@ typedef struct __wws_database_t
    */
   unsigned int size;
   /**
-   * @brief memory interface
+   * @brief memory region, at least size + 8, size + 12 with crc, 2 * (size + 16) in A/B mode
    */
   wws_memory_t memory;
-} wws_database_t;
+  /**
+   * @brief page size of memory for partial save (0 to save whole data)
+   */
+  const unsigned short page_size;
+  /**
+   * @brief hash of persisted pages, length = (size + 8) / page_size + 1 (optional)
+   */
+  unsigned int *const hashes;
+  /**
+   * @brief version of data layout, mixed into tail key
+   */
+  const unsigned short version;
+  /**
+   * @brief migrations from older versions (optional)
+   * @note without A/B the migrated image overwrites the old one in place and can not be undone,
+   * power failure midway loses both and next load re-inits (detected by crc only)
+   */
+  const wws_database_migration_t *const migrations;
+  /**
+   * @brief initial data of size, restored when migration fails (required with migrations)
+   */
+  const void *const defaults;
+  /**
+   * @brief store crc32 of data in trailer (after tail key), validated on load
+   */
+  const unsigned int crc : 1;
+  /**
+   * @brief A/B mode: memory region split into 2 slots, save writes inactive slot and
+   * commits by sequence number, load takes newest valid slot (crc implied, hashes unused)
+   */
+  const unsigned int ab : 1;
+  /**
+   * @brief flag of hashes synced with memory
+   */
+  unsigned int _hashed : 1;
+  /**
+   * @brief active slot in A/B mode
+   */
+  unsigned int _slot : 1;
+  /**
+   * @brief sequence number of active slot in A/B mode
+   */
+  unsigned int _seq;
+  /**
+   * @brief flag of save in progress
+   */
+  unsigned int _saving : 1;
+  /**
+   * @brief flag of save requested
+   */
+  unsigned int _pending : 1;
+  /**
+   * @brief flag of data written since last finished save
+   */
+  unsigned int _changed : 1;
+  /**
+   * @brief offset of next slice to save
+   */
+  unsigned int _cursor;
+  /**
+   * @brief crc of slices saved
+   */
+  unsigned int _crc;
+};
 
 /**
  * @brief load database from memory region
  * @param db
- * @return
+ * @return WWS_RET_REINIT if keys or crc invalid (of both slots in A/B mode)
+ * @note image of older version listed in migrations is migrated, only changed pages are
+ * re-persisted (whole slot in A/B mode), not power-fail safe without A/B
  */
 extern wws_ret_t wws_database_load(wws_database_t *db);
 
@@ -62,7 +152,34 @@ extern wws_ret_t wws_database_load(wws_database_t *db);
  * @brief save database to memory region
  * @param db
  * @return
+ * @note only changed pages are written if page_size and hashes are given
+ * @note blocking, restarts save in progress
  */
 extern wws_ret_t wws_database_save(wws_database_t *db);
 
+/**
+ * @brief request background save by WWS_DATABASE_SAVE_SERVICE, requests are coalesced
+ * @param db
+ */
+extern void wws_database_save_request(wws_database_t *db);
+
+/**
+ * @brief check if save is requested or in progress
+ * @param db
+ * @return true if saving, false if done
+ */
+static inline bool wws_database_is_saving(wws_database_t *db)
+{
+  return db->_saving || db->_pending;
+}
+
+extern void ___wws_database_save_service_callback(wws_phase_t on, wws_service_t *serv);
+
+/**
+ * @brief service to save database in slices (a page per routine), inst = wws_database_t
+ * @note WWS_EVT_DONE is emitted with result when save finished
+ */
+#define WWS_DATABASE_SAVE_SERVICE                                                                  \
+  .callback = ___wws_database_save_service_callback, .default_start = 1
+
 #endif /* ___WWS_DATABASE_H___ */
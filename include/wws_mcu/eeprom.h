@@ -11,6 +11,14 @@
 #include "logic.h"
 #include "i2c.h"
 #include "memory.h"
+#include "service.h"
+
+/**
+ * @brief staging buffer size for merged page writes (max page size in use)
+ */
+#ifndef WWS_CONFIG_EEPROM_PAGE_BUF_SIZE
+#define WWS_CONFIG_EEPROM_PAGE_BUF_SIZE (64U)
+#endif /** WWS_CONFIG_EEPROM_PAGE_BUF_SIZE */
 
 /**
  * @brief eeprom schema
@@ -33,12 +41,23 @@ typedef struct __wws_eeprom_schema_t
    * @brief eeprom size in bytes
    */
   const unsigned int size;
+  /**
+   * @brief write cycle time (tWR) in ticks (WWS_MS), ack is polled after it (0 to poll at once)
+   */
+  const unsigned char write_time;
 } wws_eeprom_schema_t;
 
+typedef struct __wws_eeprom_t wws_eeprom_t;
+
+/**
+ * @brief callback of async write
+ */
+typedef void (*wws_eeprom_callback_t)(wws_ret_t ret, wws_eeprom_t *eeprom, unsigned int written);
+
 /**
  * @brief eeprom
  */
-typedef struct __wws_eeprom_t
+struct __wws_eeprom_t
 {
   /**
    * @brief schema of eeprom
@@ -69,7 +88,65 @@ typedef struct __wws_eeprom_t
       unsigned int ad3 : 1;
     };
   };
-} wws_eeprom_t;
+  /**
+   * @brief read-ahead buffer for sequential reads (optional), page size is a good fit
+   */
+  unsigned char *const ahead;
+  /**
+   * @brief size of read-ahead buffer
+   */
+  const unsigned short ahead_size;
+  /**
+   * @brief address of read-ahead buffer
+   */
+  unsigned int _ahead_addr;
+  /**
+   * @brief valid length of read-ahead buffer, 0 as invalid
+   */
+  unsigned int _ahead_len;
+  /**
+   * @brief address following last read, for sequential detection
+   */
+  unsigned int _next;
+  /**
+   * @brief async write request
+   */
+  struct __wws_eeprom_req_t
+  {
+    /**
+     * @brief data to write, kept by caller until done
+     */
+    const unsigned char *data;
+    /**
+     * @brief address to write
+     */
+    unsigned int addr;
+    /**
+     * @brief length to write
+     */
+    unsigned int len;
+    /**
+     * @brief length issued
+     */
+    unsigned int done;
+    /**
+     * @brief callback when done (optional)
+     */
+    wws_eeprom_callback_t callback;
+  } _req;
+  /**
+   * @brief tick of last page write issued
+   */
+  unsigned int _write_ts;
+  /**
+   * @brief flag of write cycle may be in progress
+   */
+  unsigned int _cycle : 1;
+  /**
+   * @brief flag of async write in progress
+   */
+  unsigned int _busy : 1;
+};
 
 /** predefined schemas */
 extern const wws_eeprom_schema_t wws_eeprom_AT24C128;
@@ -79,9 +156,11 @@ extern const wws_eeprom_schema_t wws_eeprom_M24C01_W;
 extern wws_comp_t WWS_COMP_EEPROM;
 extern wws_evt_t  WWS_EVT_WRITE;
 extern wws_evt_t  WWS_EVT_READ;
+extern wws_evt_t  WWS_EVT_DONE;
 
 /** return */
 extern wws_ret_t WWS_RET_OK;
+extern wws_ret_t WWS_RET_ERR_BUSY;
 
 /**
  * @brief write into eeprom
@@ -90,7 +169,7 @@ extern wws_ret_t WWS_RET_OK;
  * @param data
  * @param len
  * @param written
- * @return
+ * @return WWS_RET_ERR_BUSY if async write in progress
  */
 extern wws_ret_t wws_eeprom_write(wws_eeprom_t        *eeprom,
                                   unsigned int         addr,
@@ -98,6 +177,58 @@ extern wws_ret_t wws_eeprom_write(wws_eeprom_t        *eeprom,
                                   unsigned int         len,
                                   unsigned int        *written);
 
+/**
+ * @brief write segments into eeprom, adjacent segments are merged into page writes
+ * @param eeprom
+ * @param base address added to offset of segments
+ * @param iov segments terminated by len = 0
+ * @param written
+ * @return WWS_RET_ERR_BUSY if async write in progress
+ */
+extern wws_ret_t wws_eeprom_writev(wws_eeprom_t          *eeprom,
+                                   unsigned int           base,
+                                   const wws_memory_iov_t iov[],
+                                   unsigned int          *written);
+
+/**
+ * @brief start async write, a page is programmed per step and bus is kept free during tWR
+ * @param eeprom
+ * @param addr
+ * @param data kept by caller until done
+ * @param len
+ * @param callback called when last write cycle finished or failed (optional)
+ * @return WWS_RET_ERR_BUSY if async write in progress
+ */
+extern wws_ret_t wws_eeprom_write_async(wws_eeprom_t         *eeprom,
+                                        unsigned int          addr,
+                                        const unsigned char  *data,
+                                        unsigned int          len,
+                                        wws_eeprom_callback_t callback);
+
+/**
+ * @brief run one step of async write
+ * @param eeprom
+ * @return true if still busy
+ */
+extern bool wws_eeprom_step(wws_eeprom_t *eeprom);
+
+/**
+ * @brief is async write in progress
+ * @param eeprom
+ * @return
+ */
+static inline bool wws_eeprom_is_busy(wws_eeprom_t *eeprom)
+{
+  return eeprom->_busy;
+}
+
+extern void ___wws_eeprom_service_callback(wws_phase_t on, wws_service_t *serv);
+
+/**
+ * @brief service to drive async write, inst = wws_eeprom_t
+ */
+#define WWS_EEPROM_SERVICE                                                                         \
+  .callback = ___wws_eeprom_service_callback, .default_start = 1
 
 /**
  * @brief read from eeprom
@@ -106,7 +237,9 @@ extern wws_ret_t wws_eeprom_write(wws_eeprom_t        *eeprom,
  * @param size
  * @param buf
  * @param buffered
- * @return
+ * @return WWS_RET_ERR_BUSY if async write in progress
+ * @note sequential small reads are served from read-ahead buffer if given
+ * @note after a blocking write, waits rest of its write cycle
  */
 extern wws_ret_t
 wws_eeprom_read(wws_eeprom_t *eeprom, unsigned int addr, unsigned int size, unsigned char *buf);
@@ -0,0 +1,91 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#ifndef ___WWS_EEPROM_SIM_H___
+#define ___WWS_EEPROM_SIM_H___
+
+#include "typedef.h"
+#include "i2c.h"
+#include "eeprom.h"
+
+extern wws_comp_t WWS_COMP_EEPROM_SIM;
+extern wws_evt_t  WWS_EVT_NACK;
+
+extern wws_ret_t WWS_RET_OK;
+extern wws_ret_t WWS_RET_ERR_NACK;
+
+/**
+ * @brief simulated I2C EEPROM for host runs, plugged as I2C interface
+ *
+ * Models in-page address wrap, NACK during write cycle (tWR of schema) and per cell wear,
+ * timed on a virtual clock advanced by bus traffic.
+ */
+typedef struct __wws_eeprom_sim_t
+{
+  /**
+   * @brief geometry and timing
+   */
+  const wws_eeprom_schema_t *const schema;
+  /**
+   * @brief cells, length = schema->size
+   */
+  unsigned char *const data;
+  /**
+   * @brief write counters per cell (optional), length = schema->size
+   */
+  unsigned int *const wear;
+  /**
+   * @brief address select pins (ADx as bits)
+   */
+  const unsigned char ad;
+  /**
+   * @brief bus bit time in ns (0 as 400kHz)
+   */
+  unsigned int bit_ns;
+  /**
+   * @brief advance system tick with virtual clock
+   */
+  const unsigned int tick : 1;
+  /**
+   * @brief virtual clock in ns
+   */
+  unsigned long long elapsed;
+  /**
+   * @brief write cycles started
+   */
+  unsigned int cycles;
+  /**
+   * @brief address NACKed
+   */
+  unsigned int nacks;
+  /**
+   * @brief end of write cycle in ns
+   */
+  unsigned long long _busy_until;
+  /**
+   * @brief address pointer
+   */
+  unsigned int _ptr;
+  /**
+   * @brief data bytes received in current write
+   */
+  unsigned int _received;
+  /**
+   * @brief address bytes received in current write
+   */
+  unsigned char _reg;
+  /**
+   * @brief phase of transaction
+   */
+  unsigned int _phase : 2;
+} wws_eeprom_sim_t;
+
+/**
+ * @brief I2C interface
+ */
+extern const wws_i2c_inf_t wws_eeprom_sim_interface;
+
+#endif /* ___WWS_EEPROM_SIM_H___ */
@@ -7,21 +7,32 @@
 #ifndef ___WWS_I2C_H___
 #define ___WWS_I2C_H___
 
+#include <stdbool.h>
 #include "typedef.h"
 
+/**
+ * @brief number of bins of latency histogram in stats
+ */
+#ifndef WWS_CONFIG_I2C_STATS_BINS
+#define WWS_CONFIG_I2C_STATS_BINS (8U)
+#endif /** WWS_CONFIG_I2C_STATS_BINS */
+
 extern wws_comp_t WWS_COMP_I2C;
 extern wws_evt_t  WWS_EVT_WRITE;
 extern wws_evt_t  WWS_EVT_READ;
 
-extern wws_xfer_t WWS_XFER_WRITE;
-extern wws_xfer_t WWS_XFER_READ;
-
 extern wws_ret_t WWS_RET_OK;
 extern wws_ret_t WWS_RET_ERR_BUSY;
 extern wws_ret_t WWS_RET_ERR_NACK;
 extern wws_ret_t WWS_RET_ERR_TIMEOUT;
 extern wws_ret_t WWS_RET_ERR_OTHER;
 
+/** forward */
+typedef struct __wws_i2c_t       wws_i2c_t;
+typedef struct __wws_i2c_req_t   wws_i2c_req_t;
+typedef struct __wws_i2c_queue_t wws_i2c_queue_t;
+typedef struct __wws_i2c_stats_t wws_i2c_stats_t;
+
 /**
  * @brief I2C low level interface
  */
@@ -52,13 +63,56 @@ typedef struct __wws_i2c_inf_t
    * @brief Get data from bus
    */
   wws_ret_t (*const get)(void *inst, unsigned char *buf, unsigned int timeout);
+  /**
+   * @brief Put block of data to bus (optional, e.g. by FIFO or DMA)
+   * @note if NULL, will use put per byte
+   */
+  wws_ret_t (*const write_buf)(void                *inst,
+                               const unsigned char *data,
+                               unsigned int         len,
+                               unsigned int         timeout);
+  /**
+   * @brief Get block of data from bus (optional, e.g. by FIFO or DMA)
+   * @note if NULL, will use get per byte
+   */
+  wws_ret_t (*const read_buf)(void          *inst,
+                              unsigned char *buf,
+                              unsigned int   len,
+                              unsigned int   timeout);
+  /**
+   * @brief Begin start (or repeated start) and address, done by wws_i2c_on_start (optional)
+   * @note async entries are all or none, if NULL wws_i2c_submit runs wws_i2c_xfer in place
+   */
+  void (*const start_async)(void *inst, unsigned short addr, wws_xfer_t xfer, bool restart);
+  /**
+   * @brief Begin put byte, done by wws_i2c_on_byte
+   */
+  void (*const put_async)(void *inst, unsigned char byte);
+  /**
+   * @brief Begin get byte (NACK if last), done by wws_i2c_on_byte
+   */
+  void (*const get_async)(void *inst, bool last);
+  /**
+   * @brief Begin stop, done by wws_i2c_on_stop
+   */
+  void (*const stop_async)(void *inst);
+  /**
+   * @brief Mask interrupts of bus while request is queued (optional)
+   * @note required if callbacks submit from interrupt (hold, bus manager) while main context
+   * submits too, called in both contexts
+   */
+  void (*const lock)(void *inst);
+  /**
+   * @brief Unmask interrupts of bus masked by lock
+   */
+  void (*const unlock)(void *inst);
 } wws_i2c_inf_t;
 
 
 /**
  * @brief i2c handler
  */
-typedef struct __wws_i2c_t
+struct __wws_i2c_t
 {
   /**
    * @brief low level interface
@@ -68,14 +122,90 @@ typedef struct __wws_i2c_t
    * @brief inst data of inst
    */
   void *const inst;
-} wws_i2c_t;
+  /**
+   * @brief queue for async transactions (optional)
+   */
+  wws_i2c_queue_t *const queue;
+  /**
+   * @brief per address statistics of wws_i2c_xfer and wws_i2c_test_device (optional)
+   */
+  wws_i2c_stats_t *const stats;
+};
+
+/**
+ * @brief statistics of one device address
+ */
+typedef struct __wws_i2c_stat_t
+{
+  /**
+   * @brief device address
+   */
+  unsigned short addr;
+  /**
+   * @brief transactions, 0 as unused entry
+   */
+  unsigned int transactions;
+  /**
+   * @brief bytes transferred by completed xfers
+   */
+  unsigned int bytes;
+  /**
+   * @brief transactions failed by NACK
+   */
+  unsigned int nacks;
+  /**
+   * @brief transactions failed by timeout
+   */
+  unsigned int timeouts;
+  /**
+   * @brief latency histogram in clock units, bin 0 as 0, bin n as [2^(n-1), 2^n), last as above
+   */
+  unsigned int latency[WWS_CONFIG_I2C_STATS_BINS];
+} wws_i2c_stat_t;
+
+/**
+ * @brief statistics table, entries taken by address on first transaction
+ */
+struct __wws_i2c_stats_t
+{
+  /**
+   * @brief entries
+   */
+  wws_i2c_stat_t *const entries;
+  /**
+   * @brief number of entries
+   */
+  const unsigned short num;
+  /**
+   * @brief clock of latency (optional, wws_tick_get as default), e.g. us timer or cycle counter
+   */
+  unsigned int (*const clock)(void);
+  /**
+   * @brief transactions not recorded as table full
+   */
+  unsigned int dropped;
+};
+
+/**
+ * @brief get statistics of address
+ * @param i2c
+ * @param addr
+ * @return 0 if none
+ */
+extern const wws_i2c_stat_t *wws_i2c_stats_get(wws_i2c_t *i2c, unsigned short addr);
+
+/**
+ * @brief clear statistics
+ * @param i2c
+ */
+extern void wws_i2c_stats_reset(wws_i2c_t *i2c);
 
 /**
  * @brief Test device status
  * @param i2c
  * @param addr
  * @param timeout
- * @return wws_ret_t
+ * @return WWS_RET_ERR_BUSY if bus owned by async queue
  */
 extern wws_ret_t wws_i2c_test_device(wws_i2c_t *i2c, unsigned short addr, unsigned int timeout);
 
@@ -93,7 +223,148 @@ typedef struct __wws_i2c_xfer_t
   wws_xfer_t     xfer;
 } wws_i2c_xfer_t;
 
+/**
+ * @brief exchange batch of xfer message in one transaction, blocking
+ * @param i2c
+ * @param addr
+ * @param xfers terminated by xfer = 0
+ * @param timeout
+ * @return WWS_RET_ERR_BUSY if bus owned by async queue
+ */
 extern wws_ret_t
 wws_i2c_xfer(wws_i2c_t *i2c, unsigned short addr, wws_i2c_xfer_t xfers[], unsigned int timeout);
 
+/**
+ * @brief completion callback of async transaction
+ * @param ret result
+ * @param i2c
+ * @param req request, released after callback
+ * @note called in interrupt context of platform
+ */
+typedef void (*wws_i2c_callback_t)(wws_ret_t ret, wws_i2c_t *i2c, const wws_i2c_req_t *req);
+
+/**
+ * @brief async transaction
+ */
+struct __wws_i2c_req_t
+{
+  /**
+   * @brief device address
+   */
+  unsigned short addr;
+  /**
+   * @brief xfers terminated by xfer = 0, kept by caller until done
+   */
+  wws_i2c_xfer_t *xfers;
+  /**
+   * @brief completion callback (optional)
+   */
+  wws_i2c_callback_t callback;
+  /**
+   * @brief context of request for callback (optional)
+   */
+  void *context;
+  /**
+   * @brief keep bus after transaction, next one queued by callback follows by repeated start
+   */
+  unsigned int hold : 1;
+};
+
+/**
+ * @brief queue of async transactions, consumed by interrupts
+ * @note submit from main context and from callbacks in interrupt is serialized by interface lock
+ */
+struct __wws_i2c_queue_t
+{
+  /**
+   * @brief pool of requests
+   */
+  wws_i2c_req_t *const reqs;
+  /**
+   * @brief number of requests in pool
+   */
+  const unsigned short num;
+  /**
+   * @brief cursor of current request, modulo 2 * num
+   */
+  volatile unsigned short _head;
+  /**
+   * @brief cursor of next request to submit, modulo 2 * num
+   */
+  volatile unsigned short _tail;
+  /**
+   * @brief flag of engine running
+   */
+  volatile unsigned short _active;
+  /**
+   * @brief flag of stop issued after held transaction finished
+   */
+  unsigned short _released;
+  /**
+   * @brief index of current xfer
+   */
+  unsigned short _xfer;
+  /**
+   * @brief bytes done in current xfer
+   */
+  unsigned short _pos;
+  /**
+   * @brief result of current transaction
+   */
+  wws_ret_t _ret;
+};
+
+/**
+ * @brief queue transaction and return immediately
+ * @param i2c
+ * @param addr
+ * @param xfers terminated by xfer = 0, kept by caller until done
+ * @param callback (optional)
+ * @return WWS_RET_ERR_BUSY if queue full
+ * @note without async interface, transaction runs in place and callback is called before return
+ */
+extern wws_ret_t wws_i2c_submit(wws_i2c_t         *i2c,
+                                unsigned short     addr,
+                                wws_i2c_xfer_t     xfers[],
+                                wws_i2c_callback_t callback);
+
+/**
+ * @brief queue prepared request (hold, context)
+ * @param i2c
+ * @param req copied into queue
+ * @return WWS_RET_ERR_BUSY if queue full
+ */
+extern wws_ret_t wws_i2c_submit_req(wws_i2c_t *i2c, const wws_i2c_req_t *req);
+
+/**
+ * @brief is any async transaction pending
+ * @param i2c
+ * @return
+ */
+static inline bool wws_i2c_is_busy(wws_i2c_t *i2c)
+{
+  return i2c->queue && (i2c->queue->_head != i2c->queue->_tail);
+}
+
+/**
+ * @brief start condition done, called from platform interrupt
+ * @param i2c
+ * @param ret WWS_RET_ERR_NACK if address not acknowledged
+ */
+extern void wws_i2c_on_start(wws_i2c_t *i2c, wws_ret_t ret);
+
+/**
+ * @brief byte put or got, called from platform interrupt
+ * @param i2c
+ * @param ret
+ * @param byte received byte
+ */
+extern void wws_i2c_on_byte(wws_i2c_t *i2c, wws_ret_t ret, unsigned char byte);
+
+/**
+ * @brief stop condition done, called from platform interrupt
+ * @param i2c
+ */
+extern void wws_i2c_on_stop(wws_i2c_t *i2c);
+
 #endif /* ___WWS_I2C_H___ */
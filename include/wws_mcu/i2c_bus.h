@@ -0,0 +1,128 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#ifndef ___WWS_I2C_BUS_H___
+#define ___WWS_I2C_BUS_H___
+
+#include "typedef.h"
+#include "i2c.h"
+#include "service.h"
+
+extern wws_ret_t WWS_RET_OK;
+extern wws_ret_t WWS_RET_ERR_BUSY;
+
+/**
+ * @brief device on shared bus with its own request queue
+ */
+typedef struct __wws_i2c_dev_t
+{
+  /**
+   * @brief device address
+   */
+  const unsigned short addr;
+  /**
+   * @brief priority, higher is served first
+   */
+  const unsigned char priority;
+  /**
+   * @brief pool of requests
+   */
+  wws_i2c_req_t *const reqs;
+  /**
+   * @brief number of requests in pool
+   */
+  const unsigned short num;
+  /**
+   * @brief cursor of current request, modulo 2 * num
+   */
+  volatile unsigned short _head;
+  /**
+   * @brief cursor of next request to submit, modulo 2 * num
+   */
+  volatile unsigned short _tail;
+  /**
+   * @brief dispatches passed over while pending, added to priority against starvation
+   */
+  unsigned short _age;
+} wws_i2c_dev_t;
+
+/**
+ * @brief bus manager, owns the bus and dispatches device queues by priority
+ *
+ * Transactions run on the async engine of i2c (wws_i2c_submit_req), one at a time.
+ * Queued transactions of a device are chained by repeated start up to batch, then the bus
+ * is re-arbitrated, so a long write sequence can not starve input polling of other devices.
+ */
+typedef struct __wws_i2c_bus_t
+{
+  /**
+   * @brief i2c, not to be used directly by drivers
+   */
+  wws_i2c_t *const i2c;
+  /**
+   * @brief devices, terminated by 0
+   */
+  wws_i2c_dev_t *const *const devs;
+  /**
+   * @brief max transactions of a device back-to-back by repeated start (0 as 1)
+   */
+  const unsigned char batch;
+  /**
+   * @brief device in transaction, 0 as idle
+   */
+  wws_i2c_dev_t *volatile _cur;
+  /**
+   * @brief transactions of current device chained so far
+   */
+  unsigned char _batched;
+  /**
+   * @brief flag of dispatch loop running, transactions finished in place are dispatched by it
+   */
+  volatile unsigned char _dispatching;
+  /**
+   * @brief flag of transaction finished while dispatching, next one is dispatched by the loop
+   */
+  volatile unsigned char _again;
+} wws_i2c_bus_t;
+
+/**
+ * @brief queue transaction of device
+ * @param bus
+ * @param dev
+ * @param xfers terminated by xfer = 0, kept by caller until done
+ * @param callback (optional)
+ * @return WWS_RET_ERR_BUSY if queue of device full
+ * @note if engine queue of i2c is full, transaction stays queued until wws_i2c_bus_step
+ */
+extern wws_ret_t wws_i2c_bus_submit(wws_i2c_bus_t     *bus,
+                                    wws_i2c_dev_t     *dev,
+                                    wws_i2c_xfer_t     xfers[],
+                                    wws_i2c_callback_t callback);
+
+/**
+ * @brief is any transaction in progress
+ * @param bus
+ * @return
+ */
+static inline bool wws_i2c_bus_is_busy(wws_i2c_bus_t *bus)
+{
+  return bus->_cur != 0;
+}
+
+/**
+ * @brief dispatch pending transactions while bus is idle, e.g. after engine queue was full
+ * @param bus
+ */
+extern void wws_i2c_bus_step(wws_i2c_bus_t *bus);
+
+extern void ___wws_i2c_bus_service_callback(wws_phase_t on, wws_service_t *serv);
+
+/**
+ * @brief service to retry dispatch of transactions, inst = wws_i2c_bus_t
+ */
+#define WWS_I2C_BUS_SERVICE .callback = ___wws_i2c_bus_service_callback, .default_start = 1
+
+#endif /* ___WWS_I2C_BUS_H___ */
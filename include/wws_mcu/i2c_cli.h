@@ -0,0 +1,43 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#ifndef ___WWS_I2C_CLI_H___
+#define ___WWS_I2C_CLI_H___
+
+#include "typedef.h"
+#include "i2c.h"
+#include "cli.h"
+
+extern wws_ret_t WWS_RET_OK;
+extern wws_ret_t WWS_RET_ERR_ARGS;
+
+/**
+ * @brief cli command printing statistics
+ */
+typedef struct __wws_i2c_stats_cmd_t
+{
+  /**
+   * @brief command, must be first
+   */
+  wws_cli_cmd_t cmd;
+  /**
+   * @brief i2c of statistics
+   */
+  wws_i2c_t *const i2c;
+} wws_i2c_stats_cmd_t;
+
+extern wws_ret_t ___wws_i2c_stats_cmd_callback(
+  wws_phase_t on, const char *ptr, unsigned int len, wws_cli_cmd_t *cmd, wws_cli_t *cli);
+
+/**
+ * @brief config for statistics command, add &inst.cmd to children
+ * @param _name command name
+ * @param _i2c
+ */
+#define WWS_I2C_STATS_CMD(_name, _i2c)                                                             \
+  .cmd = { .cmd = wws_new_cstr(_name), .callback = ___wws_i2c_stats_cmd_callback }, .i2c = (_i2c)
+
+#endif /* ___WWS_I2C_CLI_H___ */
@@ -0,0 +1,107 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#ifndef ___WWS_I2C_SOFT_H___
+#define ___WWS_I2C_SOFT_H___
+
+#include "typedef.h"
+#include "logic.h"
+#include "i2c.h"
+#include "time.h"
+
+/**
+ * @brief cpu cycles spent by pin access in each half of bit, e.g. ~24 on Cortex-M0 GPIO
+ */
+#ifndef WWS_CONFIG_I2C_SOFT_PIN_CYCLES
+#define WWS_CONFIG_I2C_SOFT_PIN_CYCLES (24U)
+#endif /** WWS_CONFIG_I2C_SOFT_PIN_CYCLES */
+
+extern wws_ret_t WWS_RET_OK;
+extern wws_ret_t WWS_RET_ERR_BUSY;
+extern wws_ret_t WWS_RET_ERR_NACK;
+extern wws_ret_t WWS_RET_ERR_TIMEOUT;
+
+/**
+ * @brief SCL low time in ns, period split by minimum tLOW : tHIGH of the mode
+ * (Fast-mode 1.3 : 0.6 us above 100 kHz, else Standard-mode 4.7 : 4.0 us)
+ * @param _bus_hz
+ */
+#define WWS_I2C_SOFT_LOW_NS(_bus_hz)                                                               \
+  (((_bus_hz) > 100000U) ? (1000000000U / (_bus_hz) * 13U / 19U) :                                 \
+                           (1000000000U / (_bus_hz) * 47U / 87U))
+
+/**
+ * @brief SCL high time in ns, rest of period
+ * @param _bus_hz
+ */
+#define WWS_I2C_SOFT_HIGH_NS(_bus_hz) ((1000000000U / (_bus_hz)) - WWS_I2C_SOFT_LOW_NS(_bus_hz))
+
+/**
+ * @brief delay loops lasting at least @p _ns on cpu, pin access of the phase deducted
+ * @param _cpu_hz
+ * @param _ns
+ */
+#define WWS_I2C_SOFT_NS_LOOPS(_cpu_hz, _ns)                                                        \
+  (((((_cpu_hz) / 1000000U) * (_ns) + 999U) / 1000U > WWS_CONFIG_I2C_SOFT_PIN_CYCLES) ?            \
+     ((((((_cpu_hz) / 1000000U) * (_ns) + 999U) / 1000U) - WWS_CONFIG_I2C_SOFT_PIN_CYCLES +        \
+       WWS_CONFIG_DELAY_LOOP_CYCLES - 1U) /                                                        \
+      WWS_CONFIG_DELAY_LOOP_CYCLES) :                                                              \
+     0)
+
+/**
+ * @brief config of delay loops for cpu and bus clock, rounded up so bus never runs faster,
+ * e.g. 8 low and 2 high for 400 kHz on 48 MHz
+ * @param _cpu_hz
+ * @param _bus_hz
+ */
+#define WWS_I2C_SOFT_TIMING(_cpu_hz, _bus_hz)                                                      \
+  .loops_low  = WWS_I2C_SOFT_NS_LOOPS(_cpu_hz, WWS_I2C_SOFT_LOW_NS(_bus_hz)),                      \
+  .loops_high = WWS_I2C_SOFT_NS_LOOPS(_cpu_hz, WWS_I2C_SOFT_HIGH_NS(_bus_hz))
+
+/**
+ * @brief bit-banged I2C master over open-drain pins
+ *
+ * Writers drive low for WWS_LOW and release for WWS_HIGH. The ack of the last byte read is
+ * sent with the next get (ACK) or with restart or stop (NACK), since get has no last flag.
+ */
+typedef struct __wws_i2c_soft_t
+{
+  /**
+   * @brief SCL output
+   */
+  wws_logic_writer_t *const scl;
+  /**
+   * @brief SDA output
+   */
+  wws_logic_writer_t *const sda;
+  /**
+   * @brief SCL input for clock stretching (optional, no stretching if 0)
+   */
+  wws_logic_reader_t *const scl_in;
+  /**
+   * @brief SDA input
+   */
+  wws_logic_reader_t *const sda_in;
+  /**
+   * @brief delay loops of SCL low (also tSU;STA and tBUF), by WWS_I2C_SOFT_TIMING
+   */
+  const unsigned int loops_low;
+  /**
+   * @brief delay loops of SCL high (also tHD;STA and tSU;STO), by WWS_I2C_SOFT_TIMING
+   */
+  const unsigned int loops_high;
+  /**
+   * @brief flag of ack of last read byte not sent yet
+   */
+  unsigned int _ack : 1;
+} wws_i2c_soft_t;
+
+/**
+ * @brief I2C interface
+ */
+extern const wws_i2c_inf_t wws_i2c_soft_interface;
+
+#endif /* ___WWS_I2C_SOFT_H___ */
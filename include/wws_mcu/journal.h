@@ -0,0 +1,124 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#ifndef ___WWS_JOURNAL_H___
+#define ___WWS_JOURNAL_H___
+
+#include "typedef.h"
+#include "memory.h"
+
+extern wws_comp_t WWS_COMP_JOURNAL;
+extern wws_evt_t  WWS_EVT_INVALID;
+extern wws_evt_t  WWS_EVT_COMPACT;
+
+extern wws_ret_t WWS_RET_OK;
+extern wws_ret_t WWS_RET_REINIT;
+extern wws_ret_t WWS_RET_ERR_OVERSIZE;
+extern wws_ret_t WWS_RET_ERR_NO_DATA;
+
+/**
+ * @brief journaled database, wear-leveled over whole memory region
+ *
+ * layout: region is split into 2 halves, active half takes the higher generation
+ * - half header: magic, generation, crc
+ * - records appended: id (2), len (2), data (len), crc (4)
+ *
+ * Changed records are appended to active half, latest record of id wins.
+ * When half is full, live records are compacted into the other half and generation flips.
+ */
+typedef struct __wws_journal_t
+{
+  /**
+   * @brief memory region
+   */
+  wws_memory_t memory;
+  /**
+   * @brief offset of latest record of each id in active half, 0 as none
+   */
+  unsigned int *const index;
+  /**
+   * @brief number of ids, id must be less than it
+   */
+  const unsigned short ids;
+  /**
+   * @brief generation of active half
+   */
+  unsigned int _gen;
+  /**
+   * @brief active half, 0 or 1
+   */
+  unsigned int _half : 1;
+  /**
+   * @brief offset to append in active half
+   */
+  unsigned int _end;
+} wws_journal_t;
+
+/**
+ * @brief mount journal and rebuild index by scanning active half
+ * @param j
+ * @return WWS_RET_REINIT if formatted
+ */
+extern wws_ret_t wws_journal_mount(wws_journal_t *j);
+
+/**
+ * @brief read latest record of id
+ * @param j
+ * @param id
+ * @param buf
+ * @param size size of buf
+ * @param len length of record (optional)
+ * @return WWS_RET_ERR_NO_DATA if no record
+ */
+extern wws_ret_t wws_journal_read(
+  wws_journal_t *j, unsigned short id, void *buf, unsigned int size, unsigned int *len);
+
+/**
+ * @brief read part of latest record of id
+ * @param j
+ * @param id
+ * @param offset offset in record
+ * @param buf
+ * @param size size of buf
+ * @param len length of record (optional)
+ * @return WWS_RET_ERR_NO_DATA if no record
+ */
+extern wws_ret_t wws_journal_pread(wws_journal_t *j,
+                                   unsigned short id,
+                                   unsigned int   offset,
+                                   void          *buf,
+                                   unsigned int   size,
+                                   unsigned int  *len);
+
+/**
+ * @brief append record of id if changed
+ * @param j
+ * @param id
+ * @param data
+ * @param len 0 to delete
+ * @return
+ */
+extern wws_ret_t
+wws_journal_write(wws_journal_t *j, unsigned short id, const void *data, unsigned int len);
+
+/**
+ * @brief append record of id gathered from segments if changed
+ * @param j
+ * @param id
+ * @param data segments in order (offset unused, up to 4), terminated by len 0, none to delete
+ * @return
+ */
+extern wws_ret_t
+wws_journal_writev(wws_journal_t *j, unsigned short id, const wws_memory_iov_t data[]);
+
+/**
+ * @brief compact live records into the other half
+ * @param j
+ * @return
+ */
+extern wws_ret_t wws_journal_compact(wws_journal_t *j);
+
+#endif /* ___WWS_JOURNAL_H___ */
@@ -0,0 +1,104 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#ifndef ___WWS_KV_H___
+#define ___WWS_KV_H___
+
+#include "typedef.h"
+#include "journal.h"
+
+#ifndef WWS_CONFIG_KV_KEY_SIZE
+#define WWS_CONFIG_KV_KEY_SIZE (32U)
+#endif /** WWS_CONFIG_KV_KEY_SIZE */
+
+extern wws_comp_t WWS_COMP_KV;
+
+extern wws_ret_t WWS_RET_OK;
+extern wws_ret_t WWS_RET_ERR_OVERSIZE;
+extern wws_ret_t WWS_RET_ERR_NO_DATA;
+
+/**
+ * @brief key of string or integer
+ */
+typedef struct __wws_kv_key_t
+{
+  /**
+   * @brief string key (length up to WWS_CONFIG_KV_KEY_SIZE), 0 for integer key
+   */
+  const char *str;
+  /**
+   * @brief integer key
+   */
+  unsigned int num;
+} wws_kv_key_t;
+
+/**
+ * @brief string key
+ */
+#define WWS_KV_STR(_str) ((wws_kv_key_t){ .str = (_str) })
+
+/**
+ * @brief integer key
+ */
+#define WWS_KV_INT(_num) ((wws_kv_key_t){ .num = (_num) })
+
+/**
+ * @brief key-value store over journal
+ *
+ * Journal id is the slot of an open-addressing hash index (linear probing).
+ * Record of slot: key (length byte and key bytes) followed by value.
+ * Hashes of slots are kept in RAM, so lookup reads memory only for the matched slot.
+ */
+typedef struct __wws_kv_t
+{
+  /**
+   * @brief journal storing records, ids as number of slots
+   */
+  wws_journal_t journal;
+  /**
+   * @brief hash of key in each slot, length = journal.ids
+   */
+  unsigned int *const hashes;
+} wws_kv_t;
+
+/**
+ * @brief mount journal and rebuild hash index
+ * @param kv
+ * @return WWS_RET_REINIT if formatted
+ */
+extern wws_ret_t wws_kv_mount(wws_kv_t *kv);
+
+/**
+ * @brief get value of key
+ * @param kv
+ * @param key
+ * @param buf
+ * @param size size of buf
+ * @param len length of value (optional)
+ * @return WWS_RET_ERR_NO_DATA if not found
+ */
+extern wws_ret_t
+wws_kv_get(wws_kv_t *kv, wws_kv_key_t key, void *buf, unsigned int size, unsigned int *len);
+
+/**
+ * @brief set value of key
+ * @param kv
+ * @param key
+ * @param data
+ * @param len
+ * @return WWS_RET_ERR_OVERSIZE if no slot left
+ */
+extern wws_ret_t wws_kv_set(wws_kv_t *kv, wws_kv_key_t key, const void *data, unsigned int len);
+
+/**
+ * @brief delete key
+ * @param kv
+ * @param key
+ * @return WWS_RET_ERR_NO_DATA if not found
+ */
+extern wws_ret_t wws_kv_delete(wws_kv_t *kv, wws_kv_key_t key);
+
+#endif /* ___WWS_KV_H___ */
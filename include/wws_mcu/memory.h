@@ -7,13 +7,45 @@
 #ifndef ___WWS_MEMORY_H___
 #define ___WWS_MEMORY_H___
 
+#include <stdint.h>
 #include "typedef.h"
+#include "service.h"
 
 extern wws_comp_t WWS_COMP_MEMORY;
+extern wws_evt_t  WWS_EVT_DONE;
 
 extern wws_ret_t WWS_RET_OK;
 extern wws_ret_t WWS_RET_ERR_OVERSIZE;
 extern wws_ret_t WWS_RET_ERR_NO_DATA;
+extern wws_ret_t WWS_RET_ERR_BUSY;
+
+/** forward */
+typedef struct __wws_memory_t       wws_memory_t;
+typedef struct __wws_memory_req_t   wws_memory_req_t;
+typedef struct __wws_memory_queue_t wws_memory_queue_t;
+
+/**
+ * @brief segment for scatter/gather, array terminated by len = 0
+ */
+typedef struct __wws_memory_iov_t
+{
+  /**
+   * @brief offset in memory region
+   */
+  unsigned int offset;
+  /**
+   * @brief buffer to read or data to write
+   */
+  union
+  {
+    char       *ptr;
+    const char *cptr;
+  };
+  /**
+   * @brief length in bytes
+   */
+  unsigned int len;
+} wws_memory_iov_t;
 
 /**
  * @brief Memory interface
@@ -74,8 +106,92 @@ typedef struct __wws_memory_inf_t
    */
   wws_ret_t (*read32)(
     void *inst, unsigned int addr, unsigned int size, int *buf, unsigned int *buffered);
+  /**
+   * @brief write segments, address of segment = base + offset
+   */
+  wws_ret_t (*writev)(
+    void *inst, unsigned int base, const wws_memory_iov_t iov[], unsigned int *written);
+  /**
+   * @brief read segments, address of segment = base + offset
+   */
+  wws_ret_t (*readv)(
+    void *inst, unsigned int base, const wws_memory_iov_t iov[], unsigned int *buffered);
 } wws_memory_inf_t;
 
+/**
+ * @brief completion callback of async request
+ * @param ret result
+ * @param m memory
+ * @param req request, released after callback
+ */
+typedef void (*wws_memory_callback_t)(wws_ret_t ret, wws_memory_t *m, const wws_memory_req_t *req);
+
+/**
+ * @brief async request
+ */
+typedef struct __wws_memory_req_t
+{
+  /**
+   * @brief WWS_XFER_WRITE or WWS_XFER_READ
+   */
+  wws_xfer_t xfer;
+  /**
+   * @brief offset in memory region
+   */
+  unsigned int offset;
+  /**
+   * @brief data to write or buffer to read
+   */
+  union
+  {
+    char       *buf;
+    const char *data;
+  };
+  /**
+   * @brief length in bytes
+   */
+  unsigned int len;
+  /**
+   * @brief bytes done
+   */
+  unsigned int done;
+  /**
+   * @brief completion callback
+   */
+  wws_memory_callback_t callback;
+} wws_memory_req_t;
+
+/**
+ * @brief queue of async requests
+ */
+typedef struct __wws_memory_queue_t
+{
+  /**
+   * @brief pool of requests
+   */
+  wws_memory_req_t *const reqs;
+  /**
+   * @brief number of requests in pool
+   */
+  const unsigned short num;
+  /**
+   * @brief max bytes per step, chunks never cross step boundary (eg. eeprom page size)
+   */
+  const unsigned short step;
+  /**
+   * @brief staging buffer to merge sequential requests into one access (optional), size = step
+   */
+  char *const buffer;
+  /**
+   * @brief index of first request
+   */
+  unsigned short _head;
+  /**
+   * @brief number of pending requests
+   */
+  unsigned short _count;
+} wws_memory_queue_t;
+
 /**
  * @brief memory
  */
@@ -90,13 +206,22 @@ typedef struct __wws_memory_t
    */
   void *const inst;
   /**
-   * @brief address base
+   * @brief address base, wide as pointer since cpu address if mapped
    */
-  const unsigned int base;
+  const uintptr_t base;
   /**
    * @brief size of memory region
    */
   const unsigned int size;
+  /**
+   * @brief region is memory-mapped, @p base is the cpu address and bulk access is plain memcpy
+   * @note interface can be remained 0 if mapped
+   */
+  const unsigned int mapped : 1;
+  /**
+   * @brief queue for async requests (optional)
+   */
+  wws_memory_queue_t *const queue;
 } wws_memory_t;
 
 /**
@@ -154,4 +279,62 @@ extern wws_ret_t wws_memory_read16(
 extern wws_ret_t wws_memory_read32(
   wws_memory_t *m, unsigned int offset, unsigned int size, int *buf, unsigned int *buffered);
 
+/**
+ * @brief write segments
+ * @param m
+ * @param iov segments terminated by len = 0
+ * @param written total bytes written
+ */
+extern wws_ret_t
+wws_memory_writev(wws_memory_t *m, const wws_memory_iov_t iov[], unsigned int *written);
+/**
+ * @brief read segments
+ * @param m
+ * @param iov segments terminated by len = 0
+ * @param buffered total bytes read
+ */
+extern wws_ret_t
+wws_memory_readv(wws_memory_t *m, const wws_memory_iov_t iov[], unsigned int *buffered);
+
+/**
+ * @brief submit async request
+ * @param m memory with queue
+ * @param xfer WWS_XFER_WRITE or WWS_XFER_READ
+ * @param offset
+ * @param buf data to write or buffer to read, must be valid until callback
+ * @param len
+ * @param callback (optional)
+ * @return WWS_RET_ERR_BUSY if queue full
+ */
+extern wws_ret_t wws_memory_submit(wws_memory_t         *m,
+                                   wws_xfer_t            xfer,
+                                   unsigned int          offset,
+                                   void                 *buf,
+                                   unsigned int          len,
+                                   wws_memory_callback_t callback);
+
+/**
+ * @brief run one step of async requests
+ * @param m
+ * @return number of pending requests
+ */
+extern unsigned int wws_memory_step(wws_memory_t *m);
+
+/**
+ * @brief is any async request pending
+ * @param m
+ * @return
+ */
+static inline bool wws_memory_is_busy(wws_memory_t *m)
+{
+  return m->queue && m->queue->_count;
+}
+
+extern void ___wws_memory_queue_service_callback(wws_phase_t on, wws_service_t *serv);
+
+/**
+ * @brief service to drive async requests, inst = wws_memory_t
+ */
+#define WWS_MEMORY_QUEUE_SERVICE .callback = ___wws_memory_queue_service_callback, .default_start = 1
+
 #endif /* ___WWS_MEMORY_H___ */
\ No newline at end of file
@@ -0,0 +1,87 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#ifndef ___WWS_MEMORY_CACHE_H___
+#define ___WWS_MEMORY_CACHE_H___
+
+#include "typedef.h"
+#include "memory.h"
+
+extern wws_comp_t WWS_COMP_MEMORY_CACHE;
+extern wws_evt_t  WWS_EVT_MISS;
+extern wws_evt_t  WWS_EVT_FLUSH;
+
+extern wws_ret_t WWS_RET_OK;
+
+/**
+ * @brief cache line
+ */
+typedef struct __wws_memory_cache_line_t
+{
+  /**
+   * @brief page index in backing memory
+   */
+  unsigned int page;
+  /**
+   * @brief last access for LRU
+   */
+  unsigned int stamp;
+  /**
+   * @brief flags
+   */
+  unsigned int valid : 1;
+  unsigned int dirty : 1;
+} wws_memory_cache_line_t;
+
+/**
+ * @brief write-back page cache over memory
+ *
+ * Use wws_memory_cache_interface with cache as inst to get a drop-in wws_memory_t,
+ * address of it is offset in backing memory.
+ *
+ * @note base of backing memory should be aligned to page size
+ */
+typedef struct __wws_memory_cache_t
+{
+  /**
+   * @brief backing memory
+   */
+  wws_memory_t *const memory;
+  /**
+   * @brief data of lines, size = page_size * num
+   */
+  char *const buffer;
+  /**
+   * @brief lines
+   */
+  wws_memory_cache_line_t *const lines;
+  /**
+   * @brief page size of backing memory (eg. eeprom page write size)
+   */
+  const unsigned short page_size;
+  /**
+   * @brief number of lines
+   */
+  const unsigned short num;
+  /**
+   * @brief access counter for LRU
+   */
+  unsigned int _stamp;
+} wws_memory_cache_t;
+
+/**
+ * @brief write back all dirty lines
+ * @param cache
+ * @return
+ */
+extern wws_ret_t wws_memory_cache_flush(wws_memory_cache_t *cache);
+
+/**
+ * @brief memory interface
+ */
+extern const wws_memory_inf_t wws_memory_cache_interface;
+
+#endif /* ___WWS_MEMORY_CACHE_H___ */
@@ -0,0 +1,114 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#ifndef ___WWS_MEMORY_SIM_H___
+#define ___WWS_MEMORY_SIM_H___
+
+#include "typedef.h"
+#include "memory.h"
+
+extern wws_comp_t WWS_COMP_MEMORY_SIM;
+extern wws_evt_t  WWS_EVT_FAULT;
+
+extern wws_ret_t WWS_RET_OK;
+extern wws_ret_t WWS_RET_ERR_FAULT;
+extern wws_ret_t WWS_RET_ERR_OTHER;
+
+/**
+ * @brief pages of storage, partial last page included
+ * @param _size
+ * @param _page_size 0 as whole storage
+ */
+#define WWS_MEMORY_SIM_PAGES(_size, _page_size)                                                    \
+  ((_page_size) ? (((_size) + (_page_size) - 1U) / (_page_size)) : 1U)
+
+/**
+ * @brief simulated memory for host runs, over RAM array or mmap file
+ */
+typedef struct __wws_memory_sim_t
+{
+  /**
+   * @brief storage, RAM array or set by wws_memory_sim_open
+   */
+  char *data;
+  /**
+   * @brief size of storage
+   */
+  unsigned int size;
+  /**
+   * @brief page size for wear and latency model (0 as whole storage)
+   */
+  const unsigned int page_size;
+  /**
+   * @brief write counters per page (optional), length = WWS_MEMORY_SIM_PAGES(size, page_size)
+   */
+  unsigned int *const wear;
+  /**
+   * @brief fault injection: writes fail after bytes written in total, when fail is set
+   */
+  unsigned int fail_after;
+  /**
+   * @brief enable fault injection, so fail_after of 0 fails the first write
+   */
+  unsigned int fail : 1;
+  /**
+   * @brief latency model in us (optional)
+   */
+  struct
+  {
+    /**
+     * @brief per access (bus transaction)
+     */
+    unsigned int op;
+    /**
+     * @brief per byte transferred
+     */
+    unsigned int byte;
+    /**
+     * @brief per page programmed (write cycle)
+     */
+    unsigned int page;
+  } latency;
+  /**
+   * @brief modeled busy time in us
+   */
+  unsigned long long elapsed;
+  /**
+   * @brief bytes written in total
+   */
+  unsigned int written;
+  /**
+   * @brief file descriptor when mapped from file
+   */
+  int _fd;
+  /**
+   * @brief flag of mapped from file
+   */
+  unsigned int _mapped : 1;
+} wws_memory_sim_t;
+
+/**
+ * @brief map file as storage, created and erased (0xFF) if not exist
+ * @param sim
+ * @param path
+ * @param size
+ * @return
+ * @note POSIX host only
+ */
+extern wws_ret_t wws_memory_sim_open(wws_memory_sim_t *sim, const char *path, unsigned int size);
+
+/**
+ * @brief sync and unmap file storage
+ * @param sim
+ */
+extern void wws_memory_sim_close(wws_memory_sim_t *sim);
+
+/**
+ * @brief memory interface
+ */
+extern const wws_memory_inf_t wws_memory_sim_interface;
+
+#endif /* ___WWS_MEMORY_SIM_H___ */
@@ -104,4 +104,31 @@
     (ok);                                                                                          \
   })
 
+/**
+ * @brief cursors of queue over pool of any length @p num, cursors run modulo 2 * num so full and
+ * empty differ without a shared count, each side advances only its own cursor
+ * @note num up to 0x7FFF
+ */
+static inline unsigned short wws_ring_next(unsigned short cur, unsigned short num)
+{
+  return ((unsigned int) cur + 1 == 2U * num) ? 0 : (unsigned short) (cur + 1);
+}
+
+/**
+ * @brief entries between cursors
+ */
+static inline unsigned short
+wws_ring_count(unsigned short head, unsigned short tail, unsigned short num)
+{
+  return (unsigned short) ((tail >= head) ? (tail - head) : (tail + 2U * num - head));
+}
+
+/**
+ * @brief index of cursor in pool
+ */
+static inline unsigned short wws_ring_index(unsigned short cur, unsigned short num)
+{
+  return (cur >= num) ? (unsigned short) (cur - num) : cur;
+}
+
 #endif /* ___WWS_RINGBUFFER_H___ */
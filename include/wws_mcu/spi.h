@@ -7,16 +7,28 @@
 #ifndef ___WWS_SPI_H___
 #define ___WWS_SPI_H___
 
+#include <stdbool.h>
 #include "typedef.h"
 #include "logic.h"
+#include "service.h"
 
 extern wws_comp_t WWS_COMP_SPI;
 extern wws_evt_t  WWS_EVT_START;
 extern wws_evt_t  WWS_EVT_XFER;
 extern wws_evt_t  WWS_EVT_STOP;
+extern wws_evt_t  WWS_EVT_UNDERRUN;
 
 extern wws_ret_t WWS_RET_OK;
+extern wws_ret_t WWS_RET_ERR_BUSY;
 extern wws_ret_t WWS_RET_ERR_OTHER;
+extern wws_ret_t WWS_RET_ERR_TIMEOUT;
+
+/** forward */
+typedef struct __wws_spi_t        wws_spi_t;
+typedef struct __wws_spi_dev_t    wws_spi_dev_t;
+typedef struct __wws_spi_req_t    wws_spi_req_t;
+typedef struct __wws_spi_queue_t  wws_spi_queue_t;
+typedef struct __wws_spi_stream_t wws_spi_stream_t;
 
 /**
  * @brief SPI device config
@@ -25,7 +37,7 @@ typedef struct __wws_spi_cfg_t
 {
 
   /**
-   * @brief delay between cs change and data transmit
+   * @brief delay in ticks between cs change and data transmit, by wws_delay
    */
   struct
   {
@@ -37,6 +49,14 @@ typedef struct __wws_spi_cfg_t
      * @brief after data transfer and cs high
      */
     unsigned int stop;
+    /**
+     * @brief after cs low and data transfer in us, by wws_delay_us, added to start
+     */
+    unsigned int start_us;
+    /**
+     * @brief after data transfer and cs high in us, by wws_delay_us, added to stop
+     */
+    unsigned int stop_us;
   } delay;
   /**
    * @brief clock speed in hz
@@ -62,6 +82,33 @@ typedef struct __wws_spi_cfg_t
   const unsigned char dummy;
 } wws_spi_cfg_t;
 
+/**
+ * @brief fields of config differing from the one applied last, for start_changed
+ */
+typedef enum __wws_spi_cfg_changed_t
+{
+  /**
+   * @brief clock speed
+   */
+  WWS_SPI_CHANGED_SPEED = 1 << 0,
+  /**
+   * @brief clock polarity
+   */
+  WWS_SPI_CHANGED_CPOL = 1 << 1,
+  /**
+   * @brief clock phase
+   */
+  WWS_SPI_CHANGED_CPHA = 1 << 2,
+  /**
+   * @brief dummy byte
+   */
+  WWS_SPI_CHANGED_DUMMY = 1 << 3,
+  /**
+   * @brief all, nothing applied yet
+   */
+  WWS_SPI_CHANGED_ALL = 0x0F,
+} wws_spi_cfg_changed_t;
+
 
 /**
  * @brief SPI message for batch
@@ -90,12 +137,22 @@ typedef struct __wws_spi_inf_t
   wws_ret_t (*start)(void *inst, wws_spi_cfg_t *cfg);
   wws_ret_t (*exchange)(void *inst, wws_spi_cfg_t *cfg, wws_spi_xfer_t *xfer);
   wws_ret_t (*stop)(void *inst, wws_spi_cfg_t *cfg);
+  /**
+   * @brief begin exchange by DMA or interrupt, done by wws_spi_on_exchange (optional)
+   * @note if NULL, streaming exchanges in service routine
+   */
+  wws_ret_t (*exchange_async)(void *inst, wws_spi_cfg_t *cfg, wws_spi_xfer_t *xfer);
+  /**
+   * @brief start reprogramming only changed fields, 0 as unchanged (optional)
+   * @note if NULL, start is called every transaction
+   */
+  wws_ret_t (*start_changed)(void *inst, wws_spi_cfg_t *cfg, unsigned int changed);
 } wws_spi_inf_t;
 
 /**
  * @brief SPI bus
  */
-typedef struct __wws_spi_t
+struct __wws_spi_t
 {
   /**
    * @brief low level interface
@@ -105,12 +162,49 @@ typedef struct __wws_spi_t
    * @brief inst inst
    */
   void *const inst;
-} wws_spi_t;
+  /**
+   * @brief stream owning the bus, 0 if none
+   */
+  wws_spi_stream_t *volatile _stream;
+  /**
+   * @brief queue for async transactions (optional)
+   */
+  wws_spi_queue_t *const queue;
+  /**
+   * @brief clock speed applied last
+   */
+  unsigned int _speed;
+  /**
+   * @brief clock polarity applied last
+   */
+  unsigned char _cpol;
+  /**
+   * @brief clock phase applied last
+   */
+  unsigned char _cpha;
+  /**
+   * @brief dummy byte applied last
+   */
+  unsigned char _dummy;
+  /**
+   * @brief flag of config applied
+   */
+  unsigned char _applied;
+};
+
+/**
+ * @brief forget config applied, e.g. after peripheral reset or low power
+ * @param spi
+ */
+static inline void wws_spi_invalidate(wws_spi_t *spi)
+{
+  spi->_applied = 0;
+}
 
 /**
  * @brief SPI device
  */
-typedef struct __wws_spi_dev_t
+struct __wws_spi_dev_t
 {
   /**
    * @brief SPI bus
@@ -125,16 +219,249 @@ typedef struct __wws_spi_dev_t
    * @brief config
    */
   wws_spi_cfg_t cfg;
-} wws_spi_dev_t;
+};
 
 
 /**
  * @brief exchange batch of xfer message
  * @param dev
  * @param xfers array of xfer message
- * @return wws_ret_t
+ * @return WWS_RET_ERR_BUSY if bus owned by stream or queue
  */
 extern wws_ret_t wws_spi_xfer(wws_spi_dev_t *dev, wws_spi_xfer_t xfers[]);
 
+/**
+ * @brief completion callback of async transaction
+ * @param ret result
+ * @param dev
+ * @param req request, released after callback
+ * @note called in service routine
+ */
+typedef void (*wws_spi_callback_t)(wws_ret_t ret, wws_spi_dev_t *dev, const wws_spi_req_t *req);
+
+/**
+ * @brief async transaction
+ */
+struct __wws_spi_req_t
+{
+  /**
+   * @brief device
+   */
+  wws_spi_dev_t *dev;
+  /**
+   * @brief xfers terminated by len = 0, kept by caller until done
+   */
+  wws_spi_xfer_t *xfers;
+  /**
+   * @brief completion callback (optional)
+   */
+  wws_spi_callback_t callback;
+};
+
+/**
+ * @brief queue of async transactions of devices on bus
+ *
+ * Transactions run in order, cs switched between devices. Selecting device and completion
+ * run in WWS_SPI_SERVICE routine, xfers of transaction are chained by exchange_async in
+ * interrupt. Without exchange_async, a transaction per routine runs in place by exchange.
+ */
+struct __wws_spi_queue_t
+{
+  /**
+   * @brief pool of requests
+   */
+  wws_spi_req_t *const reqs;
+  /**
+   * @brief number of requests in pool
+   */
+  const unsigned short num;
+  /**
+   * @brief cursor of current request, modulo 2 * num
+   */
+  volatile unsigned short _head;
+  /**
+   * @brief cursor of next request to submit, modulo 2 * num
+   */
+  volatile unsigned short _tail;
+  /**
+   * @brief index of current xfer
+   */
+  unsigned short _xfer;
+  /**
+   * @brief flag of transaction running, cs asserted
+   */
+  unsigned short _active;
+  /**
+   * @brief flag of xfers done by interrupt, to be completed by service
+   */
+  volatile unsigned short _done;
+  /**
+   * @brief result of current transaction
+   */
+  volatile wws_ret_t _ret;
+};
+
+/**
+ * @brief queue transaction and return immediately
+ * @param dev
+ * @param xfers terminated by len = 0, kept by caller until done
+ * @param callback (optional)
+ * @return WWS_RET_ERR_BUSY if queue full
+ * @note from main context only (single producer)
+ */
+extern wws_ret_t
+wws_spi_submit(wws_spi_dev_t *dev, wws_spi_xfer_t xfers[], wws_spi_callback_t callback);
+
+/**
+ * @brief is any async transaction pending
+ * @param spi
+ * @return
+ */
+static inline bool wws_spi_is_busy(wws_spi_t *spi)
+{
+  return spi->queue && (spi->queue->_head != spi->queue->_tail);
+}
+
+/**
+ * @brief complete finished transaction and begin next
+ * @param spi
+ */
+extern void wws_spi_step(wws_spi_t *spi);
+
+extern void ___wws_spi_service_callback(wws_phase_t on, wws_service_t *serv);
+
+/**
+ * @brief service to drive async transactions, inst = wws_spi_t
+ */
+#define WWS_SPI_SERVICE .callback = ___wws_spi_service_callback, .default_start = 1
+
+/**
+ * @brief producer of stream, fill next buffer
+ * @param stream
+ * @param buf
+ * @param size size of buf
+ * @return length filled, 0 to end stream
+ */
+typedef unsigned short (*wws_spi_fill_t)(wws_spi_stream_t *stream,
+                                         unsigned char    *buf,
+                                         unsigned short    size);
+
+/**
+ * @brief streaming of double buffers with cs kept asserted
+ *
+ * While buffer N is exchanged (by exchange_async), buffer N+1 is filled by producer in
+ * service routine, so the bus is configured once and kept busy. Buffer not filled in time
+ * when exchange is done counts as underrun, stream resumes with the next filled buffer.
+ */
+struct __wws_spi_stream_t
+{
+  /**
+   * @brief device
+   */
+  wws_spi_dev_t *const dev;
+  /**
+   * @brief double buffers to transmit
+   */
+  unsigned char *const bufs[2];
+  /**
+   * @brief buffers to receive (optional)
+   */
+  unsigned char *const rx[2];
+  /**
+   * @brief size of each buffer
+   */
+  const unsigned short size;
+  /**
+   * @brief producer
+   */
+  const wws_spi_fill_t fill;
+  /**
+   * @brief context for producer
+   */
+  void *const context;
+  /**
+   * @brief count of exchanges done without next buffer ready
+   */
+  volatile unsigned int underruns;
+  /**
+   * @brief length filled of each buffer, 0 as empty
+   */
+  volatile unsigned short _len[2];
+  /**
+   * @brief current exchange
+   */
+  wws_spi_xfer_t _xfer;
+  /**
+   * @brief result of stream
+   */
+  wws_ret_t _ret;
+  /**
+   * @brief buffer to fill next
+   * @note flags are whole bytes, not bit-fields, as interrupt writes some of them
+   */
+  unsigned char _fill;
+  /**
+   * @brief buffer to exchange next, switched by interrupt
+   */
+  volatile unsigned char _send;
+  /**
+   * @brief flag of exchange in progress, cleared by interrupt
+   */
+  volatile unsigned char _busy;
+  /**
+   * @brief flag of producer ended, or of exchange failed set by interrupt
+   */
+  volatile unsigned char _ended;
+  /**
+   * @brief flag of stream running
+   */
+  unsigned char _running;
+};
+
+/**
+ * @brief configure bus, assert cs and begin stream with buffers prefilled
+ * @param stream
+ * @return WWS_RET_ERR_BUSY if bus owned by other stream
+ */
+extern wws_ret_t wws_spi_stream_start(wws_spi_stream_t *stream);
+
+/**
+ * @brief end stream, waits exchange in progress, then releases cs and bus
+ * @param stream
+ * @return result of stream, WWS_RET_ERR_TIMEOUT if exchange in progress never finished
+ */
+extern wws_ret_t wws_spi_stream_stop(wws_spi_stream_t *stream);
+
+/**
+ * @brief fill buffers and drive exchanges, stream stops itself after producer ended
+ * @param stream
+ */
+extern void wws_spi_stream_step(wws_spi_stream_t *stream);
+
+/**
+ * @brief is stream running
+ * @param stream
+ * @return
+ */
+static inline bool wws_spi_stream_is_running(wws_spi_stream_t *stream)
+{
+  return stream->_running;
+}
+
+/**
+ * @brief exchange_async done (stream or queue), called from platform interrupt
+ * @param spi
+ * @param ret
+ */
+extern void wws_spi_on_exchange(wws_spi_t *spi, wws_ret_t ret);
+
+extern void ___wws_spi_stream_service_callback(wws_phase_t on, wws_service_t *serv);
+
+/**
+ * @brief service to drive stream, inst = wws_spi_stream_t
+ */
+#define WWS_SPI_STREAM_SERVICE                                                                     \
+  .callback = ___wws_spi_stream_service_callback, .default_start = 1
+
 
 #endif /* ___WWS_SPI_H___ */
@@ -10,6 +10,14 @@
 #include <stdbool.h>
 #include "typedef.h"
 
+/**
+ * @brief cpu cycles per iteration of busy delay loops (volatile counter, ~8 on Cortex-M0),
+ * shared by wws_delay_us and soft I2C
+ */
+#ifndef WWS_CONFIG_DELAY_LOOP_CYCLES
+#define WWS_CONFIG_DELAY_LOOP_CYCLES (8U)
+#endif /** WWS_CONFIG_DELAY_LOOP_CYCLES */
+
 /**
  * @brief global ticks
  */
@@ -55,6 +63,15 @@ static inline bool wws_tick_isup(unsigned int stamp, unsigned int compare)
  */
 extern void wws_delay(unsigned int ticks);
 
+/**
+ * @brief busy delay for microseconds, not bound to tick resolution
+ * @param us
+ * @note weak, calibrated loop by WWS_CONFIG_CPU_HZ, platform may override by cycle counter,
+ * never returns early, rounded up to next loop. If WWS_CONFIG_CPU_HZ is not defined, platform
+ * provides it
+ */
+extern void wws_delay_us(unsigned int us);
+
 /**
  * @brief system uptime calculated by tick
  */
@@ -107,6 +107,12 @@ typedef const char *const wws_phase_t;
  */
 typedef const char *const wws_xfer_t;
 
+/**
+ * @brief directions of xfer, shared by bus drivers and memory queue
+ */
+extern wws_xfer_t WWS_XFER_WRITE;
+extern wws_xfer_t WWS_XFER_READ;
+
 /**
  * @brief general configuration
  */
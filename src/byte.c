@@ -74,6 +74,26 @@ wws_ret_t wws_byte_put_repeat(wws_byte_t *b, char byte, unsigned int times, unsi
 }
 
 
+wws_ret_t wws_byte_write_uint(
+  wws_byte_t *b, unsigned int value, unsigned int base, unsigned int width, char pad)
+{
+  wws_assert(b && (base >= 2) && (base <= 16));
+
+  char         digits[32];
+  unsigned int len = 0;
+  wws_ret_t    ret = WWS_RET_OK;
+
+  do {
+    digits[len++] = "0123456789ABCDEF"[value % base];
+    value /= base;
+  } while (value);
+
+  if (width > len) ret = wws_byte_put_repeat(b, pad, width - len, 0);
+  while ((ret == WWS_RET_OK) && len) ret = wws_byte_put(b, digits[--len]);
+  return ret;
+}
+
+
 void wws_byte_rx_reset(wws_byte_t *b)
 {
   char c = 0;
@@ -5,50 +5,430 @@
  * Licensed under the MIT license. See LICENSE file in the project root for details.
  */
 #include <wws_mcu/database.h>
+#include <wws_mcu/crc.h>
 #include <wws_mcu/debug.h>
 
+#include <string.h>
+
 wws_comp_t         WWS_COMP_DATABASE = "Database";
 WWS_WEAK wws_evt_t WWS_EVT_INVALID   = "Invalid";
+WWS_WEAK wws_evt_t WWS_EVT_DONE      = "DONE";
+WWS_WEAK wws_evt_t WWS_EVT_MIGRATE   = "MIGRATE";
 WWS_WEAK wws_ret_t WWS_RET_OK        = "OK";
 WWS_WEAK wws_ret_t WWS_RET_REINIT    = "REINIT";
 
+#define FNV_INIT (2166136261U)
+#define CHUNK    (32U)
+
+/**
+ * @brief data range of page in memory offset
+ */
+static inline void
+page_range(wws_database_t *db, unsigned int page, unsigned int *offset, unsigned int *len)
+{
+  unsigned int start = page * db->page_size, end = start + db->page_size;
+  if (start < 4) start = 4;
+  if (end > (4 + db->size)) end = 4 + db->size;
+  *offset = start;
+  *len    = end > start ? end - start : 0;
+}
+
+/**
+ * @brief FNV-1a, chainable
+ */
+static unsigned int fnv_update(unsigned int hash, const void *data, unsigned int len)
+{
+  const unsigned char *p = data;
+  while (len--) {
+    hash ^= *p++;
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+/**
+ * @brief FNV-1a of page data
+ */
+static unsigned int page_hash(wws_database_t *db, unsigned int page)
+{
+  unsigned int offset = 0, len = 0;
+  page_range(db, page, &offset, &len);
+  return fnv_update(FNV_INIT, (const char *) db->head + offset, len);
+}
+
+static inline unsigned int page_num(wws_database_t *db)
+{
+  return (4 + db->size + db->page_size - 1) / db->page_size;
+}
+
+static void hash_sync(wws_database_t *db)
+{
+  if (!db->page_size || !db->hashes) return;
+  for (unsigned int p = 0; p < page_num(db); p++) db->hashes[p] = page_hash(db, p);
+  db->_hashed = 1;
+}
+
+/**
+ * @brief memory of slot, whole region if not A/B
+ */
+static inline wws_memory_t slot_memory(wws_database_t *db, unsigned int slot)
+{
+  if (!db->ab) return db->memory;
+
+  const unsigned int size = db->memory.size / 2;
+  return (wws_memory_t){
+    .interface = db->memory.interface,
+    .inst      = db->memory.inst,
+    .base      = db->memory.base + slot * size,
+    .size      = size,
+    .mapped    = db->memory.mapped,
+  };
+}
+
+/**
+ * @brief tail key, version mixed in (~key as version 0)
+ */
+static inline unsigned int tail_key(wws_database_t *db, unsigned short version)
+{
+  return ~(db->key ^ version);
+}
+
+/**
+ * @brief bytes of image besides data: keys, crc, and sequence number in A/B mode
+ */
+static inline unsigned int image_overhead(wws_database_t *db)
+{
+  return db->ab ? 16 : db->crc ? 12 : 8;
+}
+
+/**
+ * @brief stream memory range into crc32 (crc) or FNV-1a (hash)
+ */
+static bool
+memory_digest(wws_memory_t *m, unsigned int offset, unsigned int len, bool crc, unsigned int *out)
+{
+  char buf[CHUNK];
+  for (unsigned int l = 0; len; offset += l, len -= l) {
+    l = len > CHUNK ? CHUNK : len;
+    if (wws_memory_read8(m, offset, l, buf, 0) != WWS_RET_OK) return false;
+    *out = crc ? wws_crc32_update(*out, buf, l) : fnv_update(*out, buf, l);
+  }
+  return true;
+}
+
+/**
+ * @brief validate image of version and size in memory, data streamed and not copied
+ */
+static bool image_check(
+  wws_database_t *db, wws_memory_t *m, const wws_database_migration_t *mg, unsigned int *seq)
+{
+  const bool   trailer = db->crc || db->ab;
+  unsigned int head = 0, tail = 0, stored[2] = { 0 }, crc = WWS_CRC32_INIT;
+
+  if ((mg->size + image_overhead(db)) > m->size) return false;
+  if (wws_memory_get32(m, 0, (int *) &head) != WWS_RET_OK) return false;
+  if (wws_memory_get32(m, 4 + mg->size, (int *) &tail) != WWS_RET_OK) return false;
+  if ((head != db->key) || (tail != tail_key(db, mg->version))) return false;
+  if (!trailer) return true;
+
+  /** sequence number only in A/B mode */
+  if (wws_memory_read8(m, 8 + mg->size, db->ab ? 8 : 4, (char *) stored, 0) != WWS_RET_OK)
+    return false;
+  if (!memory_digest(m, 4, mg->size, true, &crc)) return false;
+  if (db->ab) crc = wws_crc32_update(crc, &stored[1], 4);
+  *seq = stored[1];
+  return crc == stored[0];
+}
+
+/**
+ * @brief migrate image of old version in slot into RAM and persist it
+ */
+static wws_ret_t image_migrate(
+  wws_database_t *db, const wws_database_migration_t *mg, unsigned int slot, unsigned int seq)
+{
+  wws_memory_t       m    = slot_memory(db, slot);
+  const unsigned int keep = mg->size < db->size ? mg->size : db->size;
+  wws_ret_t          ret  = WWS_RET_OK;
+
+  wws_event(WWS_COMP_DATABASE, WWS_EVT_MIGRATE, db, &mg->version);
+
+  /** common prefix is kept, rest of data remains default */
+  if ((ret = wws_memory_read8(&m, 4, keep, (char *) (db->head + 1), 0)) != WWS_RET_OK) return ret;
+  if (mg->migrate && ((ret = mg->migrate(db, &m)) != WWS_RET_OK)) return ret;
+
+  *db->head = db->key;
+  *db->tail = tail_key(db, db->version);
+
+  if (db->ab) {
+    /** committed to the other slot, old image remains until then */
+    db->_slot = slot;
+    db->_seq  = seq;
+    return wws_database_save(db);
+  }
+
+  /** pages still matching old image are skipped */
+  db->_hashed = 0;
+  if (db->page_size && db->hashes) {
+    for (unsigned int p = 0; p < page_num(db); p++) {
+      unsigned int offset = 0, len = 0, hash = FNV_INIT;
+      page_range(db, p, &offset, &len);
+      if (!memory_digest(&m, offset, len, false, &hash)) hash = ~page_hash(db, p);
+      db->hashes[p] = hash;
+    }
+    db->_hashed = 1;
+  }
+  /** trailer moved with size */
+  db->_changed = 1;
+
+  /**
+   * saved in place, so old image is lost once its data (and its tail key if size grew) is
+   * overwritten, a power failure midway leaves no valid image, only A/B mode keeps the old slot
+   */
+  if ((ret = wws_database_save(db)) != WWS_RET_OK) return ret;
+  /** tail key last, so a torn save is never taken as the new version */
+  return wws_memory_put32(&m, 4 + db->size, (int) *db->tail);
+}
+
+/**
+ * @brief validate image, then read it into RAM
+ * @return true if valid
+ * @note RAM is untouched by invalid image, so it keeps defaults for re-init
+ */
+static bool image_load(wws_database_t *db, wws_memory_t *m)
+{
+  const wws_database_migration_t current = { .version = db->version, .size = db->size };
+  unsigned int                   seq     = 0;
+
+  if (!image_check(db, m, &current, &seq)) return false;
+  if (wws_memory_read8(m, 4, db->size, (char *) (db->head + 1), 0) != WWS_RET_OK) return false;
+  *db->head = db->key;
+  *db->tail = tail_key(db, db->version);
+  return true;
+}
 
 wws_ret_t wws_database_load(wws_database_t *db)
 {
   wws_assert((db != 0) && (db->head != 0) && (db->tail != 0));
+  wws_assert((db->migrations == 0) || (db->defaults != 0));
 
   /**
    * layout:
    * 0 - 4: head key
    * 5 - size: data
    * (4 + size) - (size + 8): tail key
+   * (8 + size) - (size + 12): crc32 of data (if crc or ab)
+   * (12 + size) - (size + 16): sequence number (if ab)
+   *
+   * A/B mode puts an image in each half of memory region, newest valid one is loaded.
+   * Version is mixed into tail key, image of older version is found by migrations.
    */
   db->size = (unsigned int) ((const char *) (db->tail) - (const char *) (db->head + 1));
 
   wws_ret_t ret = WWS_RET_OK;
 
-  do {
-    if ((ret = wws_memory_get32(&db->memory, 0, (int *) db->head)) != WWS_RET_OK) break;
-    if ((ret = wws_memory_get32(&db->memory, 4 + db->size, (int *) db->tail)) != WWS_RET_OK) break;
-    if (*(db->head) != db->key) break;
-    if (*(db->tail) != ~db->key) break;
-    return WWS_RET_OK;
-  } while (0);
+  if (!db->ab) {
+    wws_assert(db->memory.size >= (db->size + image_overhead(db)));
+
+    wws_memory_t m = slot_memory(db, 0);
+    if (image_load(db, &m)) {
+      hash_sync(db);
+      return WWS_RET_OK;
+    }
+  }
+  else {
+    wws_assert((db->memory.size / 2) >= (db->size + image_overhead(db)));
+
+    unsigned int seq[2] = { 0 };
+    for (unsigned int s = 0; s < 2; s++) {
+      wws_memory_t m = slot_memory(db, s);
+      wws_memory_get32(&m, 12 + db->size, (int *) &seq[s]);
+    }
+
+    /** try newer slot first, fall back to older on torn save */
+    const unsigned int newer = ((int) (seq[1] - seq[0]) > 0) ? 1 : 0;
+    for (unsigned int i = 0; i < 2; i++) {
+      const unsigned int s = newer ^ i;
+      wws_memory_t       m = slot_memory(db, s);
+      if (!image_load(db, &m)) continue;
+      db->_slot = s;
+      db->_seq  = seq[s];
+      return WWS_RET_OK;
+    }
+  }
+
+  // older version
+  for (const wws_database_migration_t *mg = db->migrations; mg && mg->size; mg++) {
+    unsigned int slot = 0, seq = 0;
+    bool         found = false;
+
+    for (unsigned int s = 0; s < (db->ab ? 2U : 1U); s++) {
+      wws_memory_t m  = slot_memory(db, s);
+      unsigned int sq = 0;
+      if (!image_check(db, &m, mg, &sq)) continue;
+      if (found && ((int) (sq - seq) <= 0)) continue;
+      slot  = s;
+      seq   = sq;
+      found = true;
+    }
+    if (!found) continue;
+
+    if ((ret = image_migrate(db, mg, slot, seq)) == WWS_RET_OK) return WWS_RET_OK;
+    /** RAM may be half migrated */
+    memcpy(db->head + 1, db->defaults, db->size);
+    break;
+  }
 
   // invalid
   wws_event(WWS_COMP_DATABASE, WWS_EVT_INVALID, db);
+  db->_hashed = 0;
+  *db->head   = db->key;
+  *db->tail   = tail_key(db, db->version);
 
-  if ((ret = wws_memory_put32(&db->memory, 0, (int) *db->head)) != WWS_RET_OK) return ret;
-  if ((ret = wws_memory_put32(&db->memory, 4 + db->size, (int) *db->tail)) != WWS_RET_OK)
-    return ret;
+  if (!db->ab) {
+    if ((ret = wws_memory_put32(&db->memory, 0, (int) *db->head)) != WWS_RET_OK) return ret;
+    if ((ret = wws_memory_put32(&db->memory, 4 + db->size, (int) *db->tail)) != WWS_RET_OK)
+      return ret;
+  }
+  else {
+    /** first save goes to slot 0 */
+    db->_slot = 1;
+    db->_seq  = 0;
+  }
   if ((ret = wws_database_save(db)) != WWS_RET_OK) return ret;
 
   return WWS_RET_REINIT;
 }
 
+/**
+ * @brief range of image to save: data, or whole image in A/B mode
+ */
+static inline void image_range(wws_database_t *db, unsigned int *start, unsigned int *end)
+{
+  *start = db->ab ? 0 : 4;
+  *end   = db->ab ? (8 + db->size) : (4 + db->size);
+}
+
+/**
+ * @brief write trailer and finish save
+ */
+static wws_ret_t save_finish(wws_database_t *db)
+{
+  wws_ret_t ret = WWS_RET_OK;
+
+  if (db->ab) {
+    /** sequence number commits the slot */
+    const unsigned int seq        = db->_seq + 1;
+    const unsigned int trailer[2] = { wws_crc32_update(db->_crc, &seq, 4), seq };
+    wws_memory_t       m          = slot_memory(db, !db->_slot);
+    ret = wws_memory_write8(&m, 8 + db->size, (const char *) trailer, 8, 0);
+    if (ret != WWS_RET_OK) return ret;
+    db->_slot = !db->_slot;
+    db->_seq  = seq;
+  }
+  else if (db->crc && db->_changed) {
+    ret = wws_memory_put32(&db->memory, 8 + db->size, (int) db->_crc);
+    if (ret != WWS_RET_OK) return ret;
+  }
+
+  if (!db->ab && db->page_size && db->hashes) db->_hashed = 1;
+  db->_changed = 0;
+  return WWS_RET_OK;
+}
+
+/**
+ * @brief save one slice (page) of image, unchanged pages are skipped
+ * @param done set when save finished
+ * @note crc is accumulated from written slices, so data changed during save keeps image valid
+ */
+static wws_ret_t save_step(wws_database_t *db, bool *done)
+{
+  const bool   hashed = !db->ab && db->page_size && db->hashes;
+  wws_memory_t m      = slot_memory(db, !db->_slot);
+  unsigned int start  = 0, end = 0;
+  wws_ret_t    ret    = WWS_RET_OK;
+
+  image_range(db, &start, &end);
+  *done = false;
+
+  if (!db->_saving) {
+    db->_saving = 1;
+    db->_cursor = start;
+    db->_crc    = WWS_CRC32_INIT;
+  }
+
+  while (db->_cursor < end) {
+    const unsigned int at    = db->_cursor;
+    unsigned int       len   = db->page_size ? db->page_size - (at % db->page_size) : end - at;
+    bool               write = true;
+    unsigned int       hash  = 0;
+    if (len > (end - at)) len = end - at;
+
+    if (hashed) {
+      hash  = page_hash(db, at / db->page_size);
+      write = !db->_hashed || (db->hashes[at / db->page_size] != hash);
+    }
+
+    if (write) {
+      ret = wws_memory_write8(&m, at, (const char *) db->head + at, len, 0);
+      if (ret != WWS_RET_OK) {
+        /** keep hash of unwritten pages, retry on next save */
+        db->_saving = 0;
+        return ret;
+      }
+      if (hashed) db->hashes[at / db->page_size] = hash;
+      db->_changed = 1;
+    }
+
+    /** crc covers data part of slice */
+    const unsigned int from = at < 4 ? 4 : at;
+    const unsigned int to   = (at + len) > (4 + db->size) ? (4 + db->size) : (at + len);
+    if (to > from) db->_crc = wws_crc32_update(db->_crc, (const char *) db->head + from, to - from);
+    db->_cursor += len;
+
+    /** one written slice per step */
+    if (write) return WWS_RET_OK;
+  }
+
+  db->_saving = 0;
+  if ((ret = save_finish(db)) != WWS_RET_OK) return ret;
+  *done = true;
+  return WWS_RET_OK;
+}
+
 wws_ret_t wws_database_save(wws_database_t *db)
 {
   wws_assert((db != 0) && (db->size > 0));
 
-  return wws_memory_write8(&db->memory, 4, (char *) (db->head + 1), db->size, 0);
+  wws_ret_t ret  = WWS_RET_OK;
+  bool      done = false;
+
+  /** restart from current data, also covers pending request */
+  db->_saving  = 0;
+  db->_pending = 0;
+  while (!done) {
+    if ((ret = save_step(db, &done)) != WWS_RET_OK) break;
+  }
+  return ret;
+}
+
+void wws_database_save_request(wws_database_t *db)
+{
+  wws_assert((db != 0) && (db->size > 0));
+  db->_pending = 1;
+}
+
+void ___wws_database_save_service_callback(wws_phase_t on, wws_service_t *serv)
+{
+  wws_database_t *db   = serv->inst;
+  bool            done = false;
+
+  if (on != WWS_ON_ROUTINE) return;
+  if (!db->_saving) {
+    /** requests coalesced until the save starts */
+    if (!db->_pending) return;
+    db->_pending = 0;
+  }
+
+  wws_ret_t ret = save_step(db, &done);
+  if (done || (ret != WWS_RET_OK)) wws_event(WWS_COMP_DATABASE, WWS_EVT_DONE, db, ret);
 }
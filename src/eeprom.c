@@ -4,26 +4,31 @@
  * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
  * Licensed under the MIT license. See LICENSE file in the project root for details.
  */
+#include <string.h>
+
 #include <wws_mcu/eeprom.h>
 #include <wws_mcu/debug.h>
 
-#define REG_LEN_MAX (2)
+#define REG_LEN_MAX  (2)
+#define POLL_TIMEOUT (WWS_MS(100))
 
 /** schemas */
 const wws_eeprom_schema_t wws_eeprom_AT24C128 = {
-  .base_addr_7bit = 0x50, .page_size = 64, .reg_len = 2, .size = 16 * 1024
+  .base_addr_7bit = 0x50, .page_size = 64, .reg_len = 2, .size = 16 * 1024, .write_time = WWS_MS(5)
 };
 const wws_eeprom_schema_t wws_eeprom_M24C01_W = {
-  .base_addr_7bit = 0xA0 >> 1, .page_size = 16, .reg_len = 1, .size = 128
+  .base_addr_7bit = 0xA0 >> 1, .page_size = 16, .reg_len = 1, .size = 128, .write_time = WWS_MS(5)
 };
 
 /** debug */
 wws_comp_t         WWS_COMP_EEPROM = "EEPROM";
 WWS_WEAK wws_evt_t WWS_EVT_WRITE   = "WRITE";
 WWS_WEAK wws_evt_t WWS_EVT_READ    = "READ";
+WWS_WEAK wws_evt_t WWS_EVT_DONE    = "DONE";
 
 /** returns */
-WWS_WEAK wws_ret_t WWS_RET_OK = "OK";
+WWS_WEAK wws_ret_t WWS_RET_OK       = "OK";
+WWS_WEAK wws_ret_t WWS_RET_ERR_BUSY = "ERR_BUSY";
 
 static inline unsigned short _addr(wws_eeprom_t *eeprom)
 {
@@ -31,6 +36,79 @@ static inline unsigned short _addr(wws_eeprom_t *eeprom)
          (eeprom->ad1 << 1) | (eeprom->ad0 << 0);
 }
 
+/**
+ * @brief write in one page, write cycle starts after it
+ */
+static wws_ret_t
+page_program(wws_eeprom_t *eeprom, unsigned int addr, const unsigned char *data, unsigned int len)
+{
+  const unsigned char reg_addr[REG_LEN_MAX] = WWS_8BITS_BE(REG_LEN_MAX, addr);
+  wws_ret_t           ret                   = WWS_RET_OK;
+
+  wws_event(WWS_COMP_EEPROM, WWS_EVT_WRITE, eeprom, reg_addr, data, &len);
+  ret = wws_i2c_xfer(
+    eeprom->bus,
+    _addr(eeprom),
+    (wws_i2c_xfer_t[]){
+      { .cptr = reg_addr, .size = eeprom->schema->reg_len, .xfer = WWS_XFER_WRITE },
+      { .cptr = data, .size = len, .xfer = WWS_XFER_WRITE },
+      {},
+    },
+    WWS_MS(10));
+
+  if (ret == WWS_RET_OK) {
+    eeprom->_write_ts = wws_tick_get();
+    eeprom->_cycle    = 1;
+  }
+  /** invalidate read-ahead overlapped, even on failure as page may be partially written */
+  if (eeprom->_ahead_len && (addr < (eeprom->_ahead_addr + eeprom->_ahead_len)) &&
+      ((addr + len) > eeprom->_ahead_addr))
+    eeprom->_ahead_len = 0;
+  return ret;
+}
+
+/**
+ * @brief check if write cycle (tWR) surely elapsed
+ * @note tick may be taken at the end of a tick period, one tick spared
+ */
+static inline bool cycle_elapsed(wws_eeprom_t *eeprom)
+{
+  return wws_tick_isup(eeprom->_write_ts, eeprom->schema->write_time + 1);
+}
+
+/**
+ * @brief wait write cycle finished, ack is polled only if it may be in progress
+ */
+static wws_ret_t wait_ready(wws_eeprom_t *eeprom)
+{
+  wws_ret_t ret = WWS_RET_OK;
+
+  if (!eeprom->_cycle) return WWS_RET_OK;
+  if (eeprom->schema->write_time && cycle_elapsed(eeprom)) {
+    eeprom->_cycle = 0;
+    return WWS_RET_OK;
+  }
+
+  for (unsigned int ts = wws_tick_get();;) {
+    if ((ret = wws_i2c_test_device(eeprom->bus, _addr(eeprom), WWS_MS(10))) == WWS_RET_OK) break;
+    if ((ret != WWS_RET_ERR_TIMEOUT) && (ret != WWS_RET_ERR_NACK)) return ret;
+    if (wws_tick_isup(ts, POLL_TIMEOUT)) return WWS_RET_ERR_TIMEOUT;
+  }
+  eeprom->_cycle = 0;
+  return WWS_RET_OK;
+}
+
+/**
+ * @brief wait eeprom writable and write in one page
+ */
+static wws_ret_t
+page_write(wws_eeprom_t *eeprom, unsigned int addr, const unsigned char *data, unsigned int len)
+{
+  wws_ret_t ret = wait_ready(eeprom);
+  if (ret != WWS_RET_OK) return ret;
+  return page_program(eeprom, addr, data, len);
+}
+
 wws_ret_t wws_eeprom_write(wws_eeprom_t        *eeprom,
                            unsigned int         addr,
                            const unsigned char *data,
@@ -39,38 +117,78 @@ wws_ret_t wws_eeprom_write(wws_eeprom_t        *eeprom,
 {
   wws_assert(eeprom && eeprom->schema && eeprom->bus && ((addr + len) <= eeprom->schema->size));
 
-  unsigned int         wlen     = 0;
-  const unsigned short dev_addr = _addr(eeprom);
-  wws_ret_t            ret      = WWS_RET_OK;
+  unsigned int wlen = 0;
+  wws_ret_t    ret  = WWS_RET_OK;
 
+  /** async write in progress */
+  if (eeprom->_busy) return WWS_RET_ERR_BUSY;
   if (eeprom->wc) wws_logic_write(eeprom->wc, WWS_LOW);
 
   while (len) {
-    const unsigned char reg_addr[REG_LEN_MAX] = WWS_8BITS_BE(REG_LEN_MAX, addr + wlen);
-    unsigned int        wl                    = len;
-    if (wl > eeprom->schema->page_size) wl = eeprom->schema->page_size;
+    /** first partial page up to boundary, then full pages */
+    unsigned int wl = eeprom->schema->page_size - ((addr + wlen) % eeprom->schema->page_size);
+    if (wl > len) wl = len;
+
+    if ((ret = page_write(eeprom, addr + wlen, &data[wlen], wl)) != WWS_RET_OK) break;
+    wlen += wl;
+    len -= wl;
+  }
+
+  if (eeprom->wc) wws_logic_write(eeprom->wc, WWS_HIGH);
+  if (written) *written = wlen;
+
+  return ret;
+}
+
+wws_ret_t wws_eeprom_writev(wws_eeprom_t          *eeprom,
+                            unsigned int           base,
+                            const wws_memory_iov_t iov[],
+                            unsigned int          *written)
+{
+  wws_assert(eeprom && eeprom->schema && eeprom->bus && iov);
+
+  const unsigned int ps                                   = eeprom->schema->page_size;
+  unsigned char      buf[WWS_CONFIG_EEPROM_PAGE_BUF_SIZE] = { 0 };
+  unsigned int       start = 0, blen = 0, wlen = 0;
+  wws_ret_t          ret = WWS_RET_OK;
+
+  /** async write in progress */
+  if (eeprom->_busy) return WWS_RET_ERR_BUSY;
+  if (eeprom->wc) wws_logic_write(eeprom->wc, WWS_LOW);
+
+  for (int i = 0; (ret == WWS_RET_OK) && iov[i].len; i++) {
+    const unsigned int addr = base + iov[i].offset;
+    wws_assert((addr + iov[i].len) <= eeprom->schema->size);
+
+    for (unsigned int d = 0; d < iov[i].len;) {
+      /** not adjacent, write pending first */
+      if (blen && ((start + blen) != (addr + d))) {
+        if ((ret = page_write(eeprom, start, buf, blen)) != WWS_RET_OK) break;
+        wlen += blen;
+        blen = 0;
+      }
+      if (blen == 0) start = addr + d;
+
+      /** fill until page boundary or buffer full */
+      unsigned int room = ps - (start % ps);
+      if (room > sizeof(buf)) room = sizeof(buf);
+      unsigned int l = iov[i].len - d;
+      if (l > (room - blen)) l = room - blen;
 
+      memcpy(&buf[blen], &iov[i].cptr[d], l);
+      blen += l;
+      d += l;
 
-    /** wait eeprom writable */
-    for (unsigned int ts = wws_tick_get();;) {
-      if ((ret = wws_i2c_test_device(eeprom->bus, dev_addr, WWS_MS(10))) == WWS_RET_OK) break;
-      if (ret != WWS_RET_ERR_TIMEOUT) return ret;
-      if (wws_tick_isup(ts, WWS_MS(100))) return WWS_RET_ERR_TIMEOUT;
+      if (blen == room) {
+        if ((ret = page_write(eeprom, start, buf, blen)) != WWS_RET_OK) break;
+        wlen += blen;
+        blen = 0;
+      }
     }
+  }
 
-    wws_event(WWS_COMP_EEPROM, WWS_EVT_WRITE, eeprom, reg_addr, &data[wlen], &wl);
-    ret =
-      wws_i2c_xfer(eeprom->bus,
-                   dev_addr,
-                   (wws_i2c_xfer_t[]){
-                     { .cptr = reg_addr, .size = eeprom->schema->reg_len, .xfer = WWS_XFER_WRITE },
-                     { .cptr = &data[wlen], .size = wl, .xfer = WWS_XFER_WRITE },
-                     {},
-                   },
-                   WWS_MS(10));
-    if (ret != WWS_RET_OK) break;
-    wlen += wl;
-    len -= wl;
+  if ((ret == WWS_RET_OK) && blen) {
+    if ((ret = page_write(eeprom, start, buf, blen)) == WWS_RET_OK) wlen += blen;
   }
 
   if (eeprom->wc) wws_logic_write(eeprom->wc, WWS_HIGH);
@@ -79,12 +197,98 @@ wws_ret_t wws_eeprom_write(wws_eeprom_t        *eeprom,
   return ret;
 }
 
-wws_ret_t
-wws_eeprom_read(wws_eeprom_t *eeprom, unsigned int addr, unsigned int size, unsigned char *buf)
+wws_ret_t wws_eeprom_write_async(wws_eeprom_t         *eeprom,
+                                 unsigned int          addr,
+                                 const unsigned char  *data,
+                                 unsigned int          len,
+                                 wws_eeprom_callback_t callback)
 {
-  wws_assert(eeprom && eeprom->schema && eeprom->bus && ((addr + size) <= eeprom->schema->size));
+  wws_assert(eeprom && eeprom->schema && eeprom->bus && ((addr + len) <= eeprom->schema->size));
+  wws_assert(data && len);
+
+  if (eeprom->_busy) return WWS_RET_ERR_BUSY;
 
+  eeprom->_req = (struct __wws_eeprom_req_t){
+    .data = data, .addr = addr, .len = len, .done = 0, .callback = callback
+  };
+  eeprom->_busy = 1;
+
+  if (eeprom->wc) wws_logic_write(eeprom->wc, WWS_LOW);
+  return WWS_RET_OK;
+}
+
+/**
+ * @brief finish async write and notify
+ */
+static void async_finish(wws_eeprom_t *eeprom, wws_ret_t ret)
+{
+  const struct __wws_eeprom_req_t req = eeprom->_req;
+
+  if (eeprom->wc) wws_logic_write(eeprom->wc, WWS_HIGH);
+  eeprom->_busy = 0;
+
+  wws_event(WWS_COMP_EEPROM, WWS_EVT_DONE, eeprom, ret, &req.done);
+  if (req.callback) req.callback(ret, eeprom, req.done);
+}
+
+bool wws_eeprom_step(wws_eeprom_t *eeprom)
+{
+  wws_assert(eeprom && eeprom->schema && eeprom->bus);
+
+  struct __wws_eeprom_req_t *req = &eeprom->_req;
+  wws_ret_t                  ret = WWS_RET_OK;
+
+  if (!eeprom->_busy) return false;
+
+  if (eeprom->_cycle) {
+    /** write cycle in progress, keep bus free until tWR */
+    if (eeprom->schema->write_time && !cycle_elapsed(eeprom)) return true;
+
+    /** then poll ack once per step */
+    if ((ret = wws_i2c_test_device(eeprom->bus, _addr(eeprom), WWS_MS(1))) != WWS_RET_OK) {
+      if (!wws_tick_isup(eeprom->_write_ts, eeprom->schema->write_time + POLL_TIMEOUT))
+        return true;
+      async_finish(eeprom, ret);
+      return false;
+    }
+    eeprom->_cycle = 0;
+  }
+
+  /** done when cycle of last page finished */
+  if (req->done == req->len) {
+    async_finish(eeprom, WWS_RET_OK);
+    return false;
+  }
+
+  /** one page per step, never crossing page boundary */
+  const unsigned int addr = req->addr + req->done;
+  unsigned int       l    = eeprom->schema->page_size - (addr % eeprom->schema->page_size);
+  if (l > (req->len - req->done)) l = req->len - req->done;
+
+  if ((ret = page_program(eeprom, addr, &req->data[req->done], l)) != WWS_RET_OK) {
+    async_finish(eeprom, ret);
+    return false;
+  }
+  req->done += l;
+  return true;
+}
+
+void ___wws_eeprom_service_callback(wws_phase_t on, wws_service_t *serv)
+{
+  if (on == WWS_ON_ROUTINE) wws_eeprom_step(serv->inst);
+}
+
+/**
+ * @brief read from device
+ */
+static wws_ret_t
+direct_read(wws_eeprom_t *eeprom, unsigned int addr, unsigned int size, unsigned char *buf)
+{
   const unsigned char reg_addr[REG_LEN_MAX] = WWS_8BITS_BE(REG_LEN_MAX, addr);
+  wws_ret_t           ret                   = WWS_RET_OK;
+
+  /** device does not respond during write cycle */
+  if ((ret = wait_ready(eeprom)) != WWS_RET_OK) return ret;
 
   return wws_i2c_xfer(
     eeprom->bus,
@@ -97,6 +301,38 @@ wws_eeprom_read(wws_eeprom_t *eeprom, unsigned int addr, unsigned int size, unsi
     WWS_MS(10));
 }
 
+wws_ret_t
+wws_eeprom_read(wws_eeprom_t *eeprom, unsigned int addr, unsigned int size, unsigned char *buf)
+{
+  wws_assert(eeprom && eeprom->schema && eeprom->bus && ((addr + size) <= eeprom->schema->size));
+
+  /** device is deaf for tWR of each page, read would stall until async write finished */
+  if (eeprom->_busy) return WWS_RET_ERR_BUSY;
+  if (!eeprom->ahead || !eeprom->ahead_size) return direct_read(eeprom, addr, size, buf);
+
+  const bool   sequential = (addr == eeprom->_next);
+  unsigned int len        = eeprom->ahead_size;
+  wws_ret_t    ret        = WWS_RET_OK;
+  eeprom->_next           = addr + size;
+
+  /** served from read-ahead buffer */
+  if ((addr >= eeprom->_ahead_addr) &&
+      ((addr + size) <= (eeprom->_ahead_addr + eeprom->_ahead_len))) {
+    memcpy(buf, &eeprom->ahead[addr - eeprom->_ahead_addr], size);
+    return WWS_RET_OK;
+  }
+  if (!sequential || (size >= len)) return direct_read(eeprom, addr, size, buf);
+
+  /** sequential access, fetch block ahead in one transaction */
+  if ((addr + len) > eeprom->schema->size) len = eeprom->schema->size - addr;
+  eeprom->_ahead_len = 0;
+  if ((ret = direct_read(eeprom, addr, len, eeprom->ahead)) != WWS_RET_OK) return ret;
+  eeprom->_ahead_addr = addr;
+  eeprom->_ahead_len  = len;
+
+  memcpy(buf, eeprom->ahead, size);
+  return WWS_RET_OK;
+}
 
 static wws_ret_t mem_put8(void *inst, unsigned int addr, char data)
 {
@@ -120,9 +356,16 @@ mem_read8(void *inst, unsigned int addr, unsigned int size, char *buf, unsigned
   return wws_eeprom_read(inst, addr, size, (unsigned char *) buf);
 }
 
+static wws_ret_t
+mem_writev(void *inst, unsigned int base, const wws_memory_iov_t iov[], unsigned int *written)
+{
+  return wws_eeprom_writev(inst, base, iov, written);
+}
+
 const wws_memory_inf_t wws_eeprom_memory_interface = {
   .put8   = mem_put8,
   .write8 = mem_write8,
   .get8   = mem_get8,
   .read8  = mem_read8,
+  .writev = mem_writev,
 };
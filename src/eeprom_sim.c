@@ -0,0 +1,146 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#include <wws_mcu/eeprom_sim.h>
+#include <wws_mcu/time.h>
+#include <wws_mcu/debug.h>
+
+wws_comp_t         WWS_COMP_EEPROM_SIM = "EEPROMSim";
+WWS_WEAK wws_evt_t WWS_EVT_NACK        = "NACK";
+
+WWS_WEAK wws_ret_t WWS_RET_OK       = "OK";
+WWS_WEAK wws_ret_t WWS_RET_ERR_NACK = "ERR_NACK";
+
+#define BIT_NS (2500U) /** 400kHz */
+#define MS_NS  (1000000ULL)
+
+enum
+{
+  PHASE_IDLE,
+  PHASE_REG,
+  PHASE_DATA,
+  PHASE_READ,
+};
+
+/**
+ * @brief advance virtual clock by bits on bus
+ */
+static void advance(wws_eeprom_sim_t *sim, unsigned int bits)
+{
+  const unsigned long long ms = sim->elapsed / MS_NS;
+
+  sim->elapsed += (unsigned long long) bits * (sim->bit_ns ? sim->bit_ns : BIT_NS);
+  if (!sim->tick) return;
+  for (unsigned long long t = ms; t < (sim->elapsed / MS_NS); t++) ___wws_tick_inc();
+}
+
+static wws_ret_t sim_is_ready(void *inst)
+{
+  return WWS_RET_OK;
+}
+
+static wws_ret_t sim_start(void *inst, unsigned short addr, wws_xfer_t xfer, unsigned int timeout)
+{
+  wws_eeprom_sim_t *sim = inst;
+  wws_assert(sim && sim->schema && sim->data);
+
+  /** start, address byte and ack */
+  advance(sim, 10);
+
+  if ((addr != (sim->schema->base_addr_7bit | sim->ad)) || (sim->elapsed < sim->_busy_until)) {
+    sim->nacks++;
+    sim->_phase = PHASE_IDLE;
+    wws_event(WWS_COMP_EEPROM_SIM, WWS_EVT_NACK, sim, &addr);
+    return WWS_RET_ERR_NACK;
+  }
+
+  if (xfer == WWS_XFER_WRITE) {
+    sim->_phase    = PHASE_REG;
+    sim->_reg      = 0;
+    sim->_received = 0;
+  }
+  else {
+    sim->_phase = PHASE_READ;
+  }
+  return WWS_RET_OK;
+}
+
+static void sim_stop(void *inst, unsigned short addr, unsigned int timeout)
+{
+  wws_eeprom_sim_t *sim = inst;
+
+  advance(sim, 1);
+
+  /** write cycle starts at stop */
+  if ((sim->_phase == PHASE_DATA) && sim->_received) {
+    sim->_busy_until = sim->elapsed + sim->schema->write_time * MS_NS / WWS_MS(1);
+    sim->cycles++;
+  }
+  sim->_phase = PHASE_IDLE;
+}
+
+static wws_ret_t sim_put(void *inst, unsigned char byte, unsigned int timeout)
+{
+  wws_eeprom_sim_t  *sim  = inst;
+  const unsigned int size = sim->schema->size;
+  const unsigned int ps   = sim->schema->page_size;
+
+  advance(sim, 9);
+
+  if (sim->_phase == PHASE_REG) {
+    sim->_ptr = ((sim->_ptr << 8) | byte) % size;
+    if (++sim->_reg == sim->schema->reg_len) sim->_phase = PHASE_DATA;
+    return WWS_RET_OK;
+  }
+  if (sim->_phase != PHASE_DATA) return WWS_RET_ERR_NACK;
+
+  sim->data[sim->_ptr] = byte;
+  if (sim->wear) sim->wear[sim->_ptr]++;
+  sim->_received++;
+
+  /** address wraps inside page */
+  sim->_ptr = (sim->_ptr - (sim->_ptr % ps)) + ((sim->_ptr + 1) % ps);
+  return WWS_RET_OK;
+}
+
+static wws_ret_t sim_get(void *inst, unsigned char *buf, unsigned int timeout)
+{
+  wws_eeprom_sim_t *sim = inst;
+
+  advance(sim, 9);
+  if (sim->_phase != PHASE_READ) return WWS_RET_ERR_NACK;
+
+  /** address rolls over whole memory */
+  *buf      = sim->data[sim->_ptr];
+  sim->_ptr = (sim->_ptr + 1) % sim->schema->size;
+  return WWS_RET_OK;
+}
+
+static wws_ret_t
+sim_write_buf(void *inst, const unsigned char *data, unsigned int len, unsigned int timeout)
+{
+  wws_ret_t ret = WWS_RET_OK;
+  for (unsigned int i = 0; (ret == WWS_RET_OK) && (i < len); i++) ret = sim_put(inst, data[i], 0);
+  return ret;
+}
+
+static wws_ret_t
+sim_read_buf(void *inst, unsigned char *buf, unsigned int len, unsigned int timeout)
+{
+  wws_ret_t ret = WWS_RET_OK;
+  for (unsigned int i = 0; (ret == WWS_RET_OK) && (i < len); i++) ret = sim_get(inst, &buf[i], 0);
+  return ret;
+}
+
+const wws_i2c_inf_t wws_eeprom_sim_interface = {
+  .is_ready  = sim_is_ready,
+  .start     = sim_start,
+  .stop      = sim_stop,
+  .put       = sim_put,
+  .get       = sim_get,
+  .write_buf = sim_write_buf,
+  .read_buf  = sim_read_buf,
+};
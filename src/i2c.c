@@ -5,33 +5,95 @@
  * Licensed under the MIT license. See LICENSE file in the project root for details.
  */
 
+#include <string.h>
+
 #include <wws_mcu/i2c.h>
+#include <wws_mcu/ringbuffer.h>
+#include <wws_mcu/time.h>
 #include <wws_mcu/debug.h>
 #include <wws_mcu/compiler.h>
 
-extern wws_comp_t  WWS_COMP_I2C;
+wws_comp_t         WWS_COMP_I2C  = "I2C";
 WWS_WEAK wws_evt_t WWS_EVT_WRITE = "WRITE";
 WWS_WEAK wws_evt_t WWS_EVT_READ  = "READ";
 
-extern wws_xfer_t WWS_XFER_WRITE WWS_ALIAS(WWS_EVT_WRITE);
-extern wws_xfer_t WWS_XFER_READ  WWS_ALIAS(WWS_EVT_READ);
-
 WWS_WEAK wws_ret_t WWS_RET_OK          = "OK";
 WWS_WEAK wws_ret_t WWS_RET_ERR_BUSY    = "ERR_BUSY";
 WWS_WEAK wws_ret_t WWS_RET_ERR_NACK    = "ERR_NACK";
 WWS_WEAK wws_ret_t WWS_RET_ERR_TIMEOUT = "ERR_TIMEOUT";
 WWS_WEAK wws_ret_t WWS_RET_ERR_OTHER   = "ERR_OTHER";
 
+static inline unsigned int stats_clock(wws_i2c_t *i2c)
+{
+  if (!i2c->stats) return 0;
+  return i2c->stats->clock ? i2c->stats->clock() : wws_tick_get();
+}
+
+static wws_i2c_stat_t *stats_find(wws_i2c_stats_t *stats, unsigned short addr, bool take)
+{
+  for (unsigned int i = 0; i < stats->num; i++) {
+    wws_i2c_stat_t *e = &stats->entries[i];
+    if (e->transactions && (e->addr == addr)) return e;
+    if (!e->transactions && take) {
+      e->addr = addr;
+      return e;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief record transaction started at stamp
+ */
+static void stats_record(
+  wws_i2c_t *i2c, unsigned short addr, unsigned int stamp, unsigned int bytes, wws_ret_t ret)
+{
+  if (!i2c->stats) return;
+
+  const unsigned int elapsed = stats_clock(i2c) - stamp;
+  wws_i2c_stat_t    *e       = stats_find(i2c->stats, addr, true);
+  unsigned int       bin     = 0;
+
+  if (!e) {
+    i2c->stats->dropped++;
+    return;
+  }
+  for (unsigned int d = elapsed; d && (bin < (WWS_CONFIG_I2C_STATS_BINS - 1)); d >>= 1) bin++;
+
+  e->transactions++;
+  e->bytes += bytes;
+  if (ret == WWS_RET_ERR_NACK) e->nacks++;
+  if (ret == WWS_RET_ERR_TIMEOUT) e->timeouts++;
+  e->latency[bin]++;
+}
+
+const wws_i2c_stat_t *wws_i2c_stats_get(wws_i2c_t *i2c, unsigned short addr)
+{
+  wws_assert(i2c);
+  return i2c->stats ? stats_find(i2c->stats, addr, false) : 0;
+}
+
+void wws_i2c_stats_reset(wws_i2c_t *i2c)
+{
+  wws_assert(i2c);
+  if (!i2c->stats) return;
+  memset(i2c->stats->entries, 0, sizeof(wws_i2c_stat_t) * i2c->stats->num);
+  i2c->stats->dropped = 0;
+}
+
 wws_ret_t wws_i2c_test_device(wws_i2c_t *i2c, unsigned short addr, unsigned int timeout)
 {
   wws_assert(i2c && i2c->interface);
-  wws_ret_t ret = WWS_RET_OK;
+  if (i2c->queue && i2c->queue->_active) return WWS_RET_ERR_BUSY;
+  const unsigned int stamp = stats_clock(i2c);
+  wws_ret_t          ret   = WWS_RET_OK;
   do {
     if ((ret = i2c->interface->is_ready(i2c->inst)) != WWS_RET_OK) break;
     if ((ret = i2c->interface->start(i2c->inst, addr, WWS_XFER_WRITE, timeout)) != WWS_RET_OK)
       break;
   } while (0);
   i2c->interface->stop(i2c->inst, addr, timeout);
+  stats_record(i2c, addr, stamp, 0, ret);
   return ret;
 }
 
@@ -39,23 +101,37 @@ wws_ret_t
 wws_i2c_xfer(wws_i2c_t *i2c, unsigned short addr, wws_i2c_xfer_t xfers[], unsigned int timeout)
 {
   wws_assert(i2c && i2c->interface);
-  wws_ret_t ret = WWS_RET_OK;
+  /** engine owns the bus until its queue drains */
+  if (i2c->queue && i2c->queue->_active) return WWS_RET_ERR_BUSY;
+  const unsigned int stamp = stats_clock(i2c);
+  unsigned int       bytes = 0;
+  wws_ret_t          ret   = WWS_RET_OK;
 
   ret = i2c->interface->is_ready(i2c->inst);
 
   for (int i = 0; (ret == WWS_RET_OK) && (xfers[i].xfer != 0); i++) {
     wws_event(WWS_COMP_I2C, xfers[i].xfer, &xfers[i]);
 
-    if (i && i2c->interface->restart) {
+    /** consecutive writes continue in the same transaction, restart would reset the device */
+    const bool cont =
+      i && (xfers[i].xfer == WWS_XFER_WRITE) && (xfers[i - 1].xfer == WWS_XFER_WRITE);
+
+    if (i && !cont && i2c->interface->restart) {
       if ((ret = i2c->interface->restart(i2c->inst, addr, xfers[i].xfer, timeout)) != WWS_RET_OK)
         break;
     }
-    else {
+    else if (!cont) {
       if ((ret = i2c->interface->start(i2c->inst, addr, xfers[i].xfer, timeout)) != WWS_RET_OK)
         break;
     }
 
-    if (xfers[i].xfer == WWS_XFER_WRITE) {
+    if ((xfers[i].xfer == WWS_XFER_WRITE) && i2c->interface->write_buf) {
+      ret = i2c->interface->write_buf(i2c->inst, xfers[i].cptr, xfers[i].size, timeout);
+    }
+    else if ((xfers[i].xfer == WWS_XFER_READ) && i2c->interface->read_buf) {
+      ret = i2c->interface->read_buf(i2c->inst, xfers[i].ptr, xfers[i].size, timeout);
+    }
+    else if (xfers[i].xfer == WWS_XFER_WRITE) {
       for (int d = 0; d < xfers[i].size; d++) {
         if ((ret = i2c->interface->put(i2c->inst, xfers[i].cptr[d], timeout)) != WWS_RET_OK) break;
       }
@@ -65,8 +141,192 @@ wws_i2c_xfer(wws_i2c_t *i2c, unsigned short addr, wws_i2c_xfer_t xfers[], unsign
         if ((ret = i2c->interface->get(i2c->inst, &xfers[i].ptr[d], timeout)) != WWS_RET_OK) break;
       }
     }
+    if (ret == WWS_RET_OK) bytes += xfers[i].size;
   }
 
   i2c->interface->stop(i2c->inst, addr, timeout);
+  stats_record(i2c, addr, stamp, bytes, ret);
   return ret;
 }
+
+static inline wws_i2c_req_t *req_at(wws_i2c_queue_t *q, unsigned short n)
+{
+  return &q->reqs[wws_ring_index(n, q->num)];
+}
+
+/**
+ * @brief begin current transaction of queue head
+ */
+static void engine_begin(wws_i2c_t *i2c, bool restart)
+{
+  wws_i2c_queue_t *q   = i2c->queue;
+  wws_i2c_req_t   *req = req_at(q, q->_head);
+
+  q->_xfer = 0;
+  q->_pos  = 0;
+  q->_ret  = WWS_RET_OK;
+  if (req->xfers[0].xfer == 0) i2c->interface->stop_async(i2c->inst);
+  else
+    i2c->interface->start_async(i2c->inst, req->addr, req->xfers[0].xfer, restart);
+}
+
+/**
+ * @brief release queue head and notify, next transaction is begun by @p begin
+ */
+static void engine_finish(wws_i2c_t *i2c, void (*begin)(wws_i2c_t *i2c))
+{
+  wws_i2c_queue_t    *q   = i2c->queue;
+  const wws_i2c_req_t req = *req_at(q, q->_head);
+  const wws_ret_t     ret = q->_ret;
+
+  /** release before callback, so callback can submit again */
+  q->_head = wws_ring_next(q->_head, q->num);
+  if (begin) begin(i2c);
+  if (req.callback) req.callback(ret, i2c, &req);
+}
+
+static void begin_or_idle(wws_i2c_t *i2c)
+{
+  wws_i2c_queue_t *q = i2c->queue;
+  if (q->_head != q->_tail) engine_begin(i2c, false);
+  else
+    q->_active = 0;
+}
+
+/**
+ * @brief all xfers done, stop or chain next transaction by repeated start if held
+ */
+static void engine_end(wws_i2c_t *i2c)
+{
+  wws_i2c_queue_t *q = i2c->queue;
+
+  if (req_at(q, q->_head)->hold) {
+    /** callback may submit the transaction to chain */
+    engine_finish(i2c, 0);
+    if (q->_head != q->_tail) {
+      engine_begin(i2c, true);
+      return;
+    }
+    q->_released = 1;
+  }
+  i2c->interface->stop_async(i2c->inst);
+}
+
+/**
+ * @brief issue next operation of current transaction
+ */
+static void engine_next(wws_i2c_t *i2c)
+{
+  wws_i2c_queue_t *q   = i2c->queue;
+  wws_i2c_req_t   *req = req_at(q, q->_head);
+
+  for (;;) {
+    wws_i2c_xfer_t *x = &req->xfers[q->_xfer];
+
+    if (q->_pos < x->size) {
+      if (x->xfer == WWS_XFER_WRITE) i2c->interface->put_async(i2c->inst, x->cptr[q->_pos]);
+      else
+        i2c->interface->get_async(i2c->inst, (q->_pos + 1) == x->size);
+      return;
+    }
+
+    /** xfer finished */
+    wws_i2c_xfer_t *next = &req->xfers[++q->_xfer];
+    q->_pos              = 0;
+    if (next->xfer == 0) {
+      engine_end(i2c);
+      return;
+    }
+    /** consecutive writes continue in the same transaction */
+    if ((next->xfer == WWS_XFER_WRITE) && (x->xfer == WWS_XFER_WRITE)) continue;
+
+    wws_event(WWS_COMP_I2C, next->xfer, next);
+    i2c->interface->start_async(i2c->inst, req->addr, next->xfer, true);
+    return;
+  }
+}
+
+wws_ret_t wws_i2c_submit(wws_i2c_t         *i2c,
+                         unsigned short     addr,
+                         wws_i2c_xfer_t     xfers[],
+                         wws_i2c_callback_t callback)
+{
+  const wws_i2c_req_t req = { .addr = addr, .xfers = xfers, .callback = callback };
+  return wws_i2c_submit_req(i2c, &req);
+}
+
+wws_ret_t wws_i2c_submit_req(wws_i2c_t *i2c, const wws_i2c_req_t *req)
+{
+  wws_assert(i2c && i2c->interface && req && req->xfers);
+
+  const wws_i2c_inf_t *inf = i2c->interface;
+  wws_i2c_queue_t     *q   = i2c->queue;
+
+  /** no async interface, run in place */
+  if (!inf->start_async || !q) {
+    wws_ret_t ret = wws_i2c_xfer(i2c, req->addr, req->xfers, WWS_MS(10));
+    if (req->callback) req->callback(ret, i2c, req);
+    return WWS_RET_OK;
+  }
+
+  wws_assert(q->reqs && q->num && (q->num <= 0x7FFF));
+  wws_assert(inf->put_async && inf->get_async && inf->stop_async);
+
+  if (inf->lock) inf->lock(i2c->inst);
+  if (wws_ring_count(q->_head, q->_tail, q->num) >= q->num) {
+    if (inf->unlock) inf->unlock(i2c->inst);
+    return WWS_RET_ERR_BUSY;
+  }
+
+  *req_at(q, q->_tail) = *req;
+  q->_tail = wws_ring_next(q->_tail, q->num);
+
+  /** tail published first, so finishing interrupt either takes it or leaves engine idle */
+  const bool idle = !q->_active;
+  q->_active      = 1;
+  if (inf->unlock) inf->unlock(i2c->inst);
+
+  /** no interrupt of idle engine, begun out of lock */
+  if (idle) engine_begin(i2c, false);
+  return WWS_RET_OK;
+}
+
+void wws_i2c_on_start(wws_i2c_t *i2c, wws_ret_t ret)
+{
+  wws_i2c_queue_t *q = i2c->queue;
+
+  if (ret != WWS_RET_OK) {
+    q->_ret = ret;
+    i2c->interface->stop_async(i2c->inst);
+    return;
+  }
+  engine_next(i2c);
+}
+
+void wws_i2c_on_byte(wws_i2c_t *i2c, wws_ret_t ret, unsigned char byte)
+{
+  wws_i2c_queue_t *q = i2c->queue;
+  wws_i2c_xfer_t  *x = &req_at(q, q->_head)->xfers[q->_xfer];
+
+  if (ret != WWS_RET_OK) {
+    q->_ret = ret;
+    i2c->interface->stop_async(i2c->inst);
+    return;
+  }
+  if (x->xfer == WWS_XFER_READ) x->ptr[q->_pos] = byte;
+  q->_pos++;
+  engine_next(i2c);
+}
+
+void wws_i2c_on_stop(wws_i2c_t *i2c)
+{
+  wws_i2c_queue_t *q = i2c->queue;
+
+  /** held transaction already finished, bus released */
+  if (q->_released) {
+    q->_released = 0;
+    begin_or_idle(i2c);
+    return;
+  }
+  engine_finish(i2c, begin_or_idle);
+}
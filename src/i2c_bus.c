@@ -0,0 +1,141 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#include <wws_mcu/i2c_bus.h>
+#include <wws_mcu/debug.h>
+#include <wws_mcu/ringbuffer.h>
+
+WWS_WEAK wws_ret_t WWS_RET_OK       = "OK";
+WWS_WEAK wws_ret_t WWS_RET_ERR_BUSY = "ERR_BUSY";
+
+static inline unsigned short pending(wws_i2c_dev_t *dev)
+{
+  return wws_ring_count(dev->_head, dev->_tail, dev->num);
+}
+
+/**
+ * @brief pick device of highest aged priority, others pending get older
+ */
+static wws_i2c_dev_t *pick(wws_i2c_bus_t *bus)
+{
+  wws_i2c_dev_t *best = 0;
+  unsigned int   prio = 0;
+
+  for (wws_i2c_dev_t *const *d = bus->devs; *d; d++) {
+    if (!pending(*d)) continue;
+    if (!best || (((*d)->priority + (*d)->_age) > prio)) {
+      best = *d;
+      prio = (*d)->priority + (*d)->_age;
+    }
+  }
+  for (wws_i2c_dev_t *const *d = bus->devs; *d; d++) {
+    if (pending(*d) && (*d != best) && ((*d)->_age < 0xFFFF)) (*d)->_age++;
+  }
+  if (best) best->_age = 0;
+  return best;
+}
+
+static void on_done(wws_ret_t ret, wws_i2c_t *i2c, const wws_i2c_req_t *req);
+
+/**
+ * @brief run head request of device on engine
+ * @note without async interface transactions finish inside submit, on_done then only flags the
+ * next one for the loop here instead of recursing as deep as the queues
+ */
+static void dispatch(wws_i2c_bus_t *bus, wws_i2c_dev_t *dev)
+{
+  bus->_cur = dev;
+  if (bus->_dispatching) {
+    bus->_again = 1;
+    return;
+  }
+
+  do {
+    bus->_dispatching = 1;
+    do {
+      bus->_again = 0;
+      if (!(dev = bus->_cur)) break;
+
+      wws_i2c_req_t req = dev->reqs[wws_ring_index(dev->_head, dev->num)];
+      req.callback      = on_done;
+      req.context       = bus;
+      req.hold = (bus->batch > 1) && (pending(dev) > 1) && ((bus->_batched + 1) < bus->batch);
+
+      /** engine queue full (i2c also used directly), request stays queued for wws_i2c_bus_step */
+      if (wws_i2c_submit_req(bus->i2c, &req) != WWS_RET_OK) {
+        bus->_cur   = 0;
+        bus->_again = 0;
+        break;
+      }
+    } while (bus->_again);
+    bus->_dispatching = 0;
+    /** interrupt finished before loop left */
+  } while (bus->_again);
+}
+
+static void on_done(wws_ret_t ret, wws_i2c_t *i2c, const wws_i2c_req_t *req)
+{
+  wws_i2c_bus_t      *bus  = req->context;
+  wws_i2c_dev_t      *dev  = bus->_cur;
+  const wws_i2c_req_t user = dev->reqs[wws_ring_index(dev->_head, dev->num)];
+
+  /** release before callback, so callback can submit again */
+  dev->_head = wws_ring_next(dev->_head, dev->num);
+
+  /** held bus continues with same device, otherwise re-arbitrated */
+  const bool chain = req->hold && pending(dev);
+  bus->_batched    = chain ? bus->_batched + 1 : 0;
+  dispatch(bus, chain ? dev : pick(bus));
+
+  if (user.callback) user.callback(ret, i2c, &user);
+}
+
+wws_ret_t wws_i2c_bus_submit(wws_i2c_bus_t     *bus,
+                             wws_i2c_dev_t     *dev,
+                             wws_i2c_xfer_t     xfers[],
+                             wws_i2c_callback_t callback)
+{
+  wws_assert(bus && bus->i2c && bus->devs && dev && dev->reqs && dev->num && xfers);
+  wws_assert(dev->num <= 0x7FFF);
+
+  const wws_i2c_inf_t *inf = bus->i2c->interface;
+
+  /** callbacks may submit from interrupt */
+  if (inf->lock) inf->lock(bus->i2c->inst);
+  if (pending(dev) >= dev->num) {
+    if (inf->unlock) inf->unlock(bus->i2c->inst);
+    return WWS_RET_ERR_BUSY;
+  }
+
+  dev->reqs[wws_ring_index(dev->_tail, dev->num)] = (wws_i2c_req_t){
+    .addr = dev->addr, .xfers = xfers, .callback = callback
+  };
+  dev->_tail = wws_ring_next(dev->_tail, dev->num);
+  if (inf->unlock) inf->unlock(bus->i2c->inst);
+
+  /** tail published first, so finishing interrupt either takes it or leaves bus idle */
+  if (!bus->_cur) {
+    bus->_batched = 0;
+    dispatch(bus, pick(bus));
+  }
+  return WWS_RET_OK;
+}
+
+void wws_i2c_bus_step(wws_i2c_bus_t *bus)
+{
+  wws_assert(bus && bus->i2c && bus->devs);
+  if (bus->_cur) return;
+
+  wws_i2c_dev_t *dev = pick(bus);
+  if (!dev) return;
+  bus->_batched = 0;
+  dispatch(bus, dev);
+}
+
+void ___wws_i2c_bus_service_callback(wws_phase_t on, wws_service_t *serv)
+{
+  if (on == WWS_ON_ROUTINE) wws_i2c_bus_step(serv->inst);
+}
@@ -0,0 +1,44 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#include <wws_mcu/i2c_cli.h>
+#include <wws_mcu/byte.h>
+
+WWS_WEAK wws_ret_t WWS_RET_OK       = "OK";
+WWS_WEAK wws_ret_t WWS_RET_ERR_ARGS = "ERR_ARGS";
+
+wws_ret_t ___wws_i2c_stats_cmd_callback(
+  wws_phase_t on, const char *ptr, unsigned int len, wws_cli_cmd_t *cmd, wws_cli_t *cli)
+{
+  wws_i2c_stats_t *stats = ((wws_i2c_stats_cmd_t *) cmd)->i2c->stats;
+
+  if (on != WWS_ON_RUN) return WWS_RET_OK;
+  if (!stats) return WWS_RET_ERR_ARGS;
+
+  wws_byte_write_str(cli->io, "addr      xfers      bytes    nacks timeouts latency(log2)\r\n");
+  for (unsigned int i = 0; i < stats->num; i++) {
+    const wws_i2c_stat_t *e = &stats->entries[i];
+    if (!e->transactions) continue;
+
+    wws_byte_write_str(cli->io, "0x");
+    wws_byte_write_uint(cli->io, e->addr, 16, 2, '0');
+    wws_byte_write_uint(cli->io, e->transactions, 10, 11, ' ');
+    wws_byte_write_uint(cli->io, e->bytes, 10, 11, ' ');
+    wws_byte_write_uint(cli->io, e->nacks, 10, 9, ' ');
+    wws_byte_write_uint(cli->io, e->timeouts, 10, 9, ' ');
+    for (unsigned int b = 0; b < WWS_CONFIG_I2C_STATS_BINS; b++) {
+      wws_byte_put(cli->io, ' ');
+      wws_byte_write_uint(cli->io, e->latency[b], 10, 0, ' ');
+    }
+    wws_byte_write_str(cli->io, "\r\n");
+  }
+  if (stats->dropped) {
+    wws_byte_write_str(cli->io, "dropped ");
+    wws_byte_write_uint(cli->io, stats->dropped, 10, 0, ' ');
+    wws_byte_write_str(cli->io, "\r\n");
+  }
+  return WWS_RET_OK;
+}
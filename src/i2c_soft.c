@@ -0,0 +1,206 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#include <wws_mcu/i2c_soft.h>
+#include <wws_mcu/time.h>
+#include <wws_mcu/debug.h>
+
+/** clock stretching allowed during bus recovery */
+#define RECOVERY_TIMEOUT (WWS_MS(10))
+
+WWS_WEAK wws_ret_t WWS_RET_OK          = "OK";
+WWS_WEAK wws_ret_t WWS_RET_ERR_BUSY    = "ERR_BUSY";
+WWS_WEAK wws_ret_t WWS_RET_ERR_NACK    = "ERR_NACK";
+WWS_WEAK wws_ret_t WWS_RET_ERR_TIMEOUT = "ERR_TIMEOUT";
+
+/**
+ * @brief delay loop, volatile keeps it from being optimized out
+ */
+static inline void spin(unsigned int loops)
+{
+  for (volatile unsigned int n = loops; n; n--) {}
+}
+
+static inline void scl_low(wws_i2c_soft_t *s)
+{
+  wws_logic_write(s->scl, WWS_LOW);
+}
+
+/**
+ * @brief release SCL and wait slave stretching
+ */
+static inline wws_ret_t scl_high(wws_i2c_soft_t *s, unsigned int timeout)
+{
+  wws_logic_write(s->scl, WWS_HIGH);
+  if (!s->scl_in || (wws_logic_read(s->scl_in) == WWS_HIGH)) return WWS_RET_OK;
+
+  const unsigned int ts = wws_tick_get();
+  while (wws_logic_read(s->scl_in) == WWS_LOW) {
+    if (wws_tick_isup(ts, timeout)) return WWS_RET_ERR_TIMEOUT;
+  }
+  return WWS_RET_OK;
+}
+
+/**
+ * @brief clock one bit, SCL low on entry and return
+ */
+static inline wws_ret_t
+bit_xfer(wws_i2c_soft_t *s, wws_logic_t out, wws_logic_t *in, unsigned int timeout)
+{
+  wws_logic_write(s->sda, out);
+  spin(s->loops_low);
+  wws_ret_t ret = scl_high(s, timeout);
+  if (in) *in = wws_logic_read(s->sda_in);
+  spin(s->loops_high);
+  scl_low(s);
+  return ret;
+}
+
+static wws_ret_t byte_write(wws_i2c_soft_t *s, unsigned char byte, unsigned int timeout)
+{
+  wws_logic_t ack = WWS_HIGH;
+  wws_ret_t   ret = WWS_RET_OK;
+
+  for (unsigned int b = 0; b < 8; b++, byte <<= 1) {
+    if ((ret = bit_xfer(s, (byte & 0x80) ? WWS_HIGH : WWS_LOW, 0, timeout)) != WWS_RET_OK)
+      return ret;
+  }
+  if ((ret = bit_xfer(s, WWS_HIGH, &ack, timeout)) != WWS_RET_OK) return ret;
+  return ack == WWS_LOW ? WWS_RET_OK : WWS_RET_ERR_NACK;
+}
+
+/**
+ * @brief ack (or nack) of previous read byte, if pending
+ */
+static inline wws_ret_t ack_flush(wws_i2c_soft_t *s, wws_logic_t ack, unsigned int timeout)
+{
+  if (!s->_ack) return WWS_RET_OK;
+  s->_ack = 0;
+  return bit_xfer(s, ack, 0, timeout);
+}
+
+static wws_ret_t byte_read(wws_i2c_soft_t *s, unsigned char *byte, unsigned int timeout)
+{
+  wws_ret_t    ret = ack_flush(s, WWS_LOW, timeout);
+  unsigned int v   = 0;
+
+  for (unsigned int b = 0; (ret == WWS_RET_OK) && (b < 8); b++) {
+    wws_logic_t in = WWS_HIGH;
+    ret            = bit_xfer(s, WWS_HIGH, &in, timeout);
+    v              = (v << 1) | (in == WWS_HIGH);
+  }
+  *byte   = (unsigned char) v;
+  s->_ack = (ret == WWS_RET_OK);
+  return ret;
+}
+
+/**
+ * @brief stop condition, SCL low on entry
+ */
+static void stop_cond(wws_i2c_soft_t *s, unsigned int timeout)
+{
+  /** SDA rises while SCL high */
+  wws_logic_write(s->sda, WWS_LOW);
+  spin(s->loops_low);
+  scl_high(s, timeout);
+  spin(s->loops_high);
+  wws_logic_write(s->sda, WWS_HIGH);
+  spin(s->loops_low);
+}
+
+static wws_ret_t soft_is_ready(void *inst)
+{
+  wws_i2c_soft_t *s = inst;
+  wws_assert(s && s->scl && s->sda && s->sda_in);
+
+  if (s->scl_in && (wws_logic_read(s->scl_in) == WWS_LOW)) return WWS_RET_ERR_BUSY;
+  if (wws_logic_read(s->sda_in) == WWS_HIGH) return WWS_RET_OK;
+
+  /** slave holding SDA after aborted transaction, clock it out and stop to reset it */
+  s->_ack = 0;
+  for (unsigned int i = 0; (i < 9) && (wws_logic_read(s->sda_in) == WWS_LOW); i++) {
+    if (bit_xfer(s, WWS_HIGH, 0, RECOVERY_TIMEOUT) != WWS_RET_OK) return WWS_RET_ERR_BUSY;
+  }
+  stop_cond(s, RECOVERY_TIMEOUT);
+  return wws_logic_read(s->sda_in) == WWS_HIGH ? WWS_RET_OK : WWS_RET_ERR_BUSY;
+}
+
+static wws_ret_t soft_start(void *inst, unsigned short addr, wws_xfer_t xfer, unsigned int timeout)
+{
+  wws_i2c_soft_t *s = inst;
+
+  /** SDA falls while SCL high */
+  wws_logic_write(s->sda, WWS_HIGH);
+  wws_ret_t ret = scl_high(s, timeout);
+  if (ret != WWS_RET_OK) return ret;
+  spin(s->loops_low);
+  wws_logic_write(s->sda, WWS_LOW);
+  spin(s->loops_high);
+  scl_low(s);
+
+  return byte_write(s, (unsigned char) ((addr << 1) | (xfer == WWS_XFER_READ)), timeout);
+}
+
+static wws_ret_t
+soft_restart(void *inst, unsigned short addr, wws_xfer_t xfer, unsigned int timeout)
+{
+  wws_i2c_soft_t *s   = inst;
+  wws_ret_t       ret = ack_flush(s, WWS_HIGH, timeout);
+  if (ret != WWS_RET_OK) return ret;
+  wws_logic_write(s->sda, WWS_HIGH);
+  spin(s->loops_low);
+  return soft_start(inst, addr, xfer, timeout);
+}
+
+static void soft_stop(void *inst, unsigned short addr, unsigned int timeout)
+{
+  wws_i2c_soft_t *s = inst;
+  (void) addr;
+
+  ack_flush(s, WWS_HIGH, timeout);
+  stop_cond(s, timeout);
+}
+
+static wws_ret_t soft_put(void *inst, unsigned char byte, unsigned int timeout)
+{
+  return byte_write(inst, byte, timeout);
+}
+
+static wws_ret_t soft_get(void *inst, unsigned char *buf, unsigned int timeout)
+{
+  return byte_read(inst, buf, timeout);
+}
+
+static wws_ret_t
+soft_write_buf(void *inst, const unsigned char *data, unsigned int len, unsigned int timeout)
+{
+  wws_ret_t ret = WWS_RET_OK;
+  for (unsigned int i = 0; (ret == WWS_RET_OK) && (i < len); i++) {
+    ret = byte_write(inst, data[i], timeout);
+  }
+  return ret;
+}
+
+static wws_ret_t
+soft_read_buf(void *inst, unsigned char *buf, unsigned int len, unsigned int timeout)
+{
+  wws_ret_t ret = WWS_RET_OK;
+  for (unsigned int i = 0; (ret == WWS_RET_OK) && (i < len); i++) {
+    ret = byte_read(inst, &buf[i], timeout);
+  }
+  return ret;
+}
+
+const wws_i2c_inf_t wws_i2c_soft_interface = {
+  .is_ready  = soft_is_ready,
+  .start     = soft_start,
+  .restart   = soft_restart,
+  .stop      = soft_stop,
+  .put       = soft_put,
+  .get       = soft_get,
+  .write_buf = soft_write_buf,
+  .read_buf  = soft_read_buf,
+};
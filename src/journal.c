@@ -0,0 +1,297 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#include <wws_mcu/journal.h>
+#include <wws_mcu/crc.h>
+#include <wws_mcu/debug.h>
+
+wws_comp_t         WWS_COMP_JOURNAL = "Journal";
+WWS_WEAK wws_evt_t WWS_EVT_INVALID  = "Invalid";
+WWS_WEAK wws_evt_t WWS_EVT_COMPACT  = "COMPACT";
+
+WWS_WEAK wws_ret_t WWS_RET_OK     = "OK";
+WWS_WEAK wws_ret_t WWS_RET_REINIT = "REINIT";
+
+#define MAGIC    (0x4C4E524AU) /** "JRNL" */
+#define REC_HEAD (sizeof(record_t))
+#define REC_TAIL (4U)
+#define CHUNK    (32U)
+#define SEGS     (4U) /** max data segments of writev */
+
+/**
+ * @brief header of half
+ */
+typedef struct
+{
+  unsigned int magic;
+  unsigned int gen;
+  unsigned int crc;
+} header_t;
+
+/**
+ * @brief head of record
+ */
+typedef struct
+{
+  unsigned short id;
+  unsigned short len;
+} record_t;
+
+static inline unsigned int half_size(wws_journal_t *j)
+{
+  return j->memory.size / 2;
+}
+
+static inline unsigned int half_base(wws_journal_t *j, unsigned int half)
+{
+  return half * half_size(j);
+}
+
+static wws_ret_t header_read(wws_journal_t *j, unsigned int half, unsigned int *gen)
+{
+  header_t  h   = { 0 };
+  wws_ret_t ret = wws_memory_read8(&j->memory, half_base(j, half), sizeof(h), (char *) &h, 0);
+  if (ret != WWS_RET_OK) return ret;
+  if ((h.magic != MAGIC) || (h.crc != wws_crc32_update(0, &h, 8))) return WWS_RET_ERR_NO_DATA;
+  *gen = h.gen;
+  return WWS_RET_OK;
+}
+
+static wws_ret_t header_write(wws_journal_t *j, unsigned int half, unsigned int gen)
+{
+  header_t h = { .magic = MAGIC, .gen = gen };
+  h.crc      = wws_crc32_update(0, &h, 8);
+  return wws_memory_write8(&j->memory, half_base(j, half), (const char *) &h, sizeof(h), 0);
+}
+
+/**
+ * @brief crc of record at offset, data streamed by chunk
+ */
+static wws_ret_t
+record_crc(wws_journal_t *j, unsigned int at, const record_t *rec, unsigned int *crc)
+{
+  char         buf[CHUNK];
+  unsigned int c   = wws_crc32_update(j->_gen, rec, REC_HEAD);
+  wws_ret_t    ret = WWS_RET_OK;
+
+  for (unsigned int d = 0, l = 0; d < rec->len; d += l) {
+    l = (rec->len - d) > CHUNK ? CHUNK : (rec->len - d);
+    if ((ret = wws_memory_read8(&j->memory, at + REC_HEAD + d, l, buf, 0)) != WWS_RET_OK)
+      return ret;
+    c = wws_crc32_update(c, buf, l);
+  }
+  *crc = c;
+  return ret;
+}
+
+/**
+ * @brief copy record between offsets, crc seeded by gen
+ */
+static wws_ret_t record_copy(
+  wws_journal_t *j, unsigned int from, unsigned int to, const record_t *rec, unsigned int gen)
+{
+  char         buf[CHUNK];
+  unsigned int crc = wws_crc32_update(gen, rec, REC_HEAD);
+  wws_ret_t    ret = wws_memory_write8(&j->memory, to, (const char *) rec, REC_HEAD, 0);
+
+  for (unsigned int d = 0, l = 0; (ret == WWS_RET_OK) && (d < rec->len); d += l) {
+    l = (rec->len - d) > CHUNK ? CHUNK : (rec->len - d);
+    if ((ret = wws_memory_read8(&j->memory, from + REC_HEAD + d, l, buf, 0)) != WWS_RET_OK)
+      break;
+    ret = wws_memory_write8(&j->memory, to + REC_HEAD + d, buf, l, 0);
+    crc = wws_crc32_update(crc, buf, l);
+  }
+  if (ret != WWS_RET_OK) return ret;
+  return wws_memory_put32(&j->memory, to + REC_HEAD + rec->len, (int) crc);
+}
+
+wws_ret_t wws_journal_mount(wws_journal_t *j)
+{
+  wws_assert(j && j->index && j->ids && (j->memory.size >= 2 * (sizeof(header_t) + 16)));
+
+  unsigned int gen[2] = { 0 };
+  bool         ok[2]  = { false };
+  wws_ret_t    ret    = WWS_RET_OK;
+
+  for (unsigned int id = 0; id < j->ids; id++) j->index[id] = 0;
+
+  for (unsigned int h = 0; h < 2; h++) {
+    ret = header_read(j, h, &gen[h]);
+    if ((ret != WWS_RET_OK) && (ret != WWS_RET_ERR_NO_DATA)) return ret;
+    ok[h] = (ret == WWS_RET_OK);
+  }
+
+  if (!ok[0] && !ok[1]) {
+    /** format */
+    wws_event(WWS_COMP_JOURNAL, WWS_EVT_INVALID, j);
+    if ((ret = header_write(j, 0, 1)) != WWS_RET_OK) return ret;
+    j->_half = 0;
+    j->_gen  = 1;
+    j->_end  = sizeof(header_t);
+    return WWS_RET_REINIT;
+  }
+
+  j->_half = (!ok[0] || (ok[1] && ((int) (gen[1] - gen[0]) > 0))) ? 1 : 0;
+  j->_gen  = gen[j->_half];
+
+  /** scan until erased, torn or stale record */
+  const unsigned int base = half_base(j, j->_half), size = half_size(j);
+  unsigned int       off  = sizeof(header_t);
+  while ((off + REC_HEAD + REC_TAIL) <= size) {
+    record_t     rec = { 0 };
+    unsigned int crc = 0, stored = 0;
+
+    ret = wws_memory_read8(&j->memory, base + off, REC_HEAD, (char *) &rec, 0);
+    if (ret != WWS_RET_OK) return ret;
+    if ((rec.id == 0xFFFF) || (rec.len > (size - off - REC_HEAD - REC_TAIL))) break;
+
+    if ((ret = record_crc(j, base + off, &rec, &crc)) != WWS_RET_OK) return ret;
+    ret = wws_memory_get32(&j->memory, base + off + REC_HEAD + rec.len, (int *) &stored);
+    if (ret != WWS_RET_OK) return ret;
+    if (crc != stored) break;
+
+    /** id out of range is record of other firmware, skipped */
+    if (rec.id < j->ids) j->index[rec.id] = rec.len ? off : 0;
+    off += REC_HEAD + rec.len + REC_TAIL;
+  }
+  j->_end = off;
+
+  return WWS_RET_OK;
+}
+
+wws_ret_t wws_journal_read(
+  wws_journal_t *j, unsigned short id, void *buf, unsigned int size, unsigned int *len)
+{
+  return wws_journal_pread(j, id, 0, buf, size, len);
+}
+
+wws_ret_t wws_journal_pread(wws_journal_t *j,
+                            unsigned short id,
+                            unsigned int   offset,
+                            void          *buf,
+                            unsigned int   size,
+                            unsigned int  *len)
+{
+  wws_assert(j && j->index && (id < j->ids));
+
+  const unsigned int at  = half_base(j, j->_half) + j->index[id];
+  record_t           rec = { 0 };
+  wws_ret_t          ret = WWS_RET_OK;
+
+  if (j->index[id] == 0) return WWS_RET_ERR_NO_DATA;
+  if ((ret = wws_memory_read8(&j->memory, at, REC_HEAD, (char *) &rec, 0)) != WWS_RET_OK)
+    return ret;
+  if (len) *len = rec.len;
+  if (offset >= rec.len) return WWS_RET_OK;
+  if (size > (rec.len - offset)) size = rec.len - offset;
+  return wws_memory_read8(&j->memory, at + REC_HEAD + offset, size, buf, 0);
+}
+
+/**
+ * @brief crc of record with data segments, seeded by gen
+ */
+static unsigned int data_crc(unsigned int gen, const record_t *rec, const wws_memory_iov_t data[])
+{
+  unsigned int crc = wws_crc32_update(gen, rec, REC_HEAD);
+  for (; data->len; data++) crc = wws_crc32_update(crc, data->cptr, data->len);
+  return crc;
+}
+
+wws_ret_t
+wws_journal_write(wws_journal_t *j, unsigned short id, const void *data, unsigned int len)
+{
+  const wws_memory_iov_t seg[2] = { { .cptr = data, .len = len } };
+  return wws_journal_writev(j, id, seg);
+}
+
+wws_ret_t wws_journal_writev(wws_journal_t *j, unsigned short id, const wws_memory_iov_t data[])
+{
+  unsigned int len = 0, n = 0;
+  for (; data[n].len; n++) len += data[n].len;
+  wws_assert(j && j->index && (id < j->ids) && (n <= SEGS) && (len < 0xFFFF));
+
+  const record_t     rec  = { .id = id, .len = len };
+  const unsigned int need = REC_HEAD + len + REC_TAIL;
+  unsigned int       crc  = data_crc(j->_gen, &rec, data);
+  wws_ret_t          ret  = WWS_RET_OK;
+
+  /** unchanged, no write */
+  if (j->index[id]) {
+    const unsigned int at     = half_base(j, j->_half) + j->index[id];
+    record_t           old    = { 0 };
+    unsigned int       stored = 0;
+    if ((ret = wws_memory_read8(&j->memory, at, REC_HEAD, (char *) &old, 0)) != WWS_RET_OK)
+      return ret;
+    if (old.len == len) {
+      ret = wws_memory_get32(&j->memory, at + REC_HEAD + len, (int *) &stored);
+      if (ret != WWS_RET_OK) return ret;
+      if (stored == crc) return WWS_RET_OK;
+    }
+  }
+  else if (len == 0) {
+    return WWS_RET_OK;
+  }
+
+  if (need > (half_size(j) - sizeof(header_t))) return WWS_RET_ERR_OVERSIZE;
+  if ((j->_end + need) > half_size(j)) {
+    if ((ret = wws_journal_compact(j)) != WWS_RET_OK) return ret;
+    if ((j->_end + need) > half_size(j)) return WWS_RET_ERR_OVERSIZE;
+    /** generation changed */
+    crc = data_crc(j->_gen, &rec, data);
+  }
+
+  const unsigned int at            = half_base(j, j->_half) + j->_end;
+  unsigned int       off           = at + REC_HEAD;
+  wws_memory_iov_t   iov[SEGS + 3] = {
+    { .offset = at, .cptr = (const char *) &rec, .len = REC_HEAD },
+  };
+  for (unsigned int i = 0; i < n; off += data[i++].len) {
+    iov[i + 1] = (wws_memory_iov_t){ .offset = off, .cptr = data[i].cptr, .len = data[i].len };
+  }
+  iov[n + 1] = (wws_memory_iov_t){ .offset = off, .cptr = (const char *) &crc, .len = REC_TAIL };
+
+  if ((ret = wws_memory_writev(&j->memory, iov, 0)) != WWS_RET_OK) return ret;
+
+  j->index[id] = len ? j->_end : 0;
+  j->_end += need;
+  return WWS_RET_OK;
+}
+
+wws_ret_t wws_journal_compact(wws_journal_t *j)
+{
+  wws_assert(j && j->index);
+
+  const unsigned int next = !j->_half, gen = j->_gen + 1;
+  const unsigned int from = half_base(j, j->_half), to = half_base(j, next);
+  unsigned int       off = sizeof(header_t);
+  wws_ret_t          ret = WWS_RET_OK;
+
+  wws_event(WWS_COMP_JOURNAL, WWS_EVT_COMPACT, j);
+
+  for (unsigned int id = 0; (ret == WWS_RET_OK) && (id < j->ids); id++) {
+    record_t rec = { 0 };
+    if (j->index[id] == 0) continue;
+
+    ret = wws_memory_read8(&j->memory, from + j->index[id], REC_HEAD, (char *) &rec, 0);
+    if (ret != WWS_RET_OK) break;
+    if ((ret = record_copy(j, from + j->index[id], to + off, &rec, gen)) != WWS_RET_OK) break;
+    j->index[id] = off;
+    off += REC_HEAD + rec.len + REC_TAIL;
+  }
+
+  /** header written last, switch is atomic */
+  if (ret == WWS_RET_OK) ret = header_write(j, next, gen);
+  if (ret != WWS_RET_OK) {
+    /** old half still active, restore index */
+    wws_journal_mount(j);
+    return ret;
+  }
+
+  j->_half = next;
+  j->_gen  = gen;
+  j->_end  = off;
+  return WWS_RET_OK;
+}
@@ -0,0 +1,185 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#include <string.h>
+
+#include <wws_mcu/kv.h>
+#include <wws_mcu/debug.h>
+
+wws_comp_t WWS_COMP_KV = "KV";
+
+WWS_WEAK wws_ret_t WWS_RET_OK           = "OK";
+WWS_WEAK wws_ret_t WWS_RET_REINIT       = "REINIT";
+WWS_WEAK wws_ret_t WWS_RET_ERR_OVERSIZE = "ERR_OVERSIZE";
+WWS_WEAK wws_ret_t WWS_RET_ERR_NO_DATA  = "ERR_NO_DATA";
+
+#define EMPTY   (0U) /** hash of empty slot */
+#define TOMB    (1U) /** hash of deleted slot, keeps probe chain */
+#define KEY_INT (0x80U)
+#define ENC_MAX (1 + WWS_CONFIG_KV_KEY_SIZE)
+
+/**
+ * @brief encode key as length byte and key bytes
+ * @return encoded length
+ */
+static unsigned int key_encode(wws_kv_key_t key, char enc[ENC_MAX])
+{
+  if (!key.str) {
+    enc[0] = (char) (KEY_INT | sizeof(key.num));
+    memcpy(&enc[1], &key.num, sizeof(key.num));
+    return 1 + sizeof(key.num);
+  }
+
+  const unsigned int len = strlen(key.str);
+  wws_assert((len > 0) && (len <= WWS_CONFIG_KV_KEY_SIZE) && (len < KEY_INT));
+  enc[0] = (char) len;
+  memcpy(&enc[1], key.str, len);
+  return 1 + len;
+}
+
+/**
+ * @brief FNV-1a of encoded key, never EMPTY nor TOMB
+ */
+static unsigned int key_hash(const char *enc, unsigned int len)
+{
+  unsigned int hash = 2166136261U;
+  while (len--) {
+    hash ^= (unsigned char) *enc++;
+    hash *= 16777619U;
+  }
+  return hash > TOMB ? hash : hash + 2;
+}
+
+/**
+ * @brief probe slots of key
+ * @param found slot of key, -1 if not found
+ * @param avail first empty or deleted slot on probe chain, -1 if none
+ */
+static wws_ret_t
+key_find(wws_kv_t *kv, const char *enc, unsigned int elen, int *found, int *avail)
+{
+  const unsigned int ids  = kv->journal.ids;
+  const unsigned int hash = key_hash(enc, elen);
+
+  *found = -1;
+  *avail = -1;
+  /** home slot reduced first, so hash + i never wraps and each probe is the next slot */
+  for (unsigned int i = 0; i < ids; i++) {
+    const unsigned int s = (hash % ids + i) % ids;
+    if (kv->hashes[s] == EMPTY) {
+      if (*avail < 0) *avail = s;
+      return WWS_RET_OK;
+    }
+    if (kv->hashes[s] == TOMB) {
+      if (*avail < 0) *avail = s;
+      continue;
+    }
+    if (kv->hashes[s] != hash) continue;
+
+    /** verify key on hash hit */
+    char         buf[ENC_MAX];
+    unsigned int len = 0;
+    wws_ret_t    ret = wws_journal_pread(&kv->journal, s, 0, buf, elen, &len);
+    if (ret != WWS_RET_OK) return ret;
+    if ((len >= elen) && (memcmp(buf, enc, elen) == 0)) {
+      *found = s;
+      return WWS_RET_OK;
+    }
+  }
+  return WWS_RET_OK;
+}
+
+wws_ret_t wws_kv_mount(wws_kv_t *kv)
+{
+  wws_assert(kv && kv->hashes);
+
+  const wws_ret_t mounted = wws_journal_mount(&kv->journal);
+  if ((mounted != WWS_RET_OK) && (mounted != WWS_RET_REINIT)) return mounted;
+
+  for (unsigned int s = 0; s < kv->journal.ids; s++) {
+    char         enc[ENC_MAX];
+    unsigned int len = 0;
+    wws_ret_t    ret = wws_journal_pread(&kv->journal, s, 0, enc, sizeof(enc), &len);
+
+    if (ret == WWS_RET_ERR_NO_DATA) {
+      kv->hashes[s] = EMPTY;
+      continue;
+    }
+    if (ret != WWS_RET_OK) return ret;
+
+    const unsigned int elen = 1 + ((unsigned char) enc[0] & ~KEY_INT);
+    kv->hashes[s]           = (enc[0] && (elen <= len)) ? key_hash(enc, elen) : TOMB;
+  }
+  return mounted;
+}
+
+wws_ret_t
+wws_kv_get(wws_kv_t *kv, wws_kv_key_t key, void *buf, unsigned int size, unsigned int *len)
+{
+  wws_assert(kv && kv->hashes);
+
+  char               enc[ENC_MAX];
+  const unsigned int elen  = key_encode(key, enc);
+  int                found = -1, avail = -1;
+  unsigned int       rlen  = 0;
+  wws_ret_t          ret   = key_find(kv, enc, elen, &found, &avail);
+
+  if (ret != WWS_RET_OK) return ret;
+  if (found < 0) return WWS_RET_ERR_NO_DATA;
+  if ((ret = wws_journal_pread(&kv->journal, found, elen, buf, size, &rlen)) != WWS_RET_OK)
+    return ret;
+  if (len) *len = rlen - elen;
+  return WWS_RET_OK;
+}
+
+wws_ret_t wws_kv_set(wws_kv_t *kv, wws_kv_key_t key, const void *data, unsigned int len)
+{
+  wws_assert(kv && kv->hashes && (data || (len == 0)));
+
+  char               enc[ENC_MAX];
+  const unsigned int elen  = key_encode(key, enc);
+  int                found = -1, avail = -1;
+  wws_ret_t          ret   = key_find(kv, enc, elen, &found, &avail);
+
+  if (ret != WWS_RET_OK) return ret;
+  if ((found < 0) && (avail < 0)) return WWS_RET_ERR_OVERSIZE;
+
+  const int              s      = found >= 0 ? found : avail;
+  const wws_memory_iov_t seg[3] = { { .cptr = enc, .len = elen }, { .cptr = data, .len = len } };
+  if ((ret = wws_journal_writev(&kv->journal, s, seg)) != WWS_RET_OK) return ret;
+
+  kv->hashes[s] = key_hash(enc, elen);
+  return WWS_RET_OK;
+}
+
+wws_ret_t wws_kv_delete(wws_kv_t *kv, wws_kv_key_t key)
+{
+  wws_assert(kv && kv->hashes);
+
+  char               enc[ENC_MAX];
+  const unsigned int elen  = key_encode(key, enc);
+  const unsigned int ids   = kv->journal.ids;
+  int                found = -1, avail = -1;
+  wws_ret_t          ret   = key_find(kv, enc, elen, &found, &avail);
+
+  if (ret != WWS_RET_OK) return ret;
+  if (found < 0) return WWS_RET_ERR_NO_DATA;
+
+  /** end of probe chain, slot and deleted slots before it can be emptied */
+  if (kv->hashes[(found + 1) % ids] == EMPTY) {
+    for (unsigned int s = found, i = 0; i < ids; i++, s = (s + ids - 1) % ids) {
+      if ((s != (unsigned int) found) && (kv->hashes[s] != TOMB)) break;
+      if ((ret = wws_journal_write(&kv->journal, s, 0, 0)) != WWS_RET_OK) return ret;
+      kv->hashes[s] = EMPTY;
+    }
+    return WWS_RET_OK;
+  }
+
+  const char tomb = 0;
+  if ((ret = wws_journal_write(&kv->journal, found, &tomb, 1)) != WWS_RET_OK) return ret;
+  kv->hashes[found] = TOMB;
+  return WWS_RET_OK;
+}
@@ -4,20 +4,204 @@
  * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
  * Licensed under the MIT license. See LICENSE file in the project root for details.
  */
+#include <string.h>
+
 #include <wws_mcu/memory.h>
 #include <wws_mcu/debug.h>
 
+wws_comp_t         WWS_COMP_MEMORY = "Memory";
+WWS_WEAK wws_evt_t WWS_EVT_DONE    = "DONE";
+
+WWS_WEAK wws_ret_t WWS_RET_OK           = "OK";
+WWS_WEAK wws_ret_t WWS_RET_ERR_OVERSIZE = "ERR_OVERSIZE";
+WWS_WEAK wws_ret_t WWS_RET_ERR_NO_DATA  = "ERR_NO_DATA";
+WWS_WEAK wws_ret_t WWS_RET_ERR_BUSY     = "ERR_BUSY";
+
+/**
+ * @brief cpu address of offset in mapped region
+ */
+static inline void *mapped_ptr(wws_memory_t *m, unsigned int offset)
+{
+  return (void *) (m->base + offset);
+}
+
+/**
+ * @brief widest word the interface can put, 1 / 2 / 4
+ */
+static inline unsigned int put_width(const wws_memory_inf_t *inf)
+{
+  if (inf->put32 || inf->write32) return 4;
+  if (inf->put16 || inf->write16) return 2;
+  return 1;
+}
+
+/**
+ * @brief widest word the interface can get, 1 / 2 / 4
+ */
+static inline unsigned int get_width(const wws_memory_inf_t *inf)
+{
+  if (inf->get32 || inf->read32) return 4;
+  if (inf->get16 || inf->read16) return 2;
+  return 1;
+}
+
+/**
+ * @brief put one word from unaligned source
+ */
+static wws_ret_t put_word(wws_memory_t *m, unsigned int addr, const char *src, unsigned int width)
+{
+  const wws_memory_inf_t *inf = m->interface;
+  unsigned int            w   = 0;
+  if (width == 4) {
+    int word;
+    memcpy(&word, src, 4);
+    if (inf->put32) return inf->put32(m->inst, addr, word);
+    return inf->write32(m->inst, addr, &word, 1, &w);
+  }
+  short word;
+  memcpy(&word, src, 2);
+  if (inf->put16) return inf->put16(m->inst, addr, word);
+  return inf->write16(m->inst, addr, &word, 1, &w);
+}
+
+/**
+ * @brief get one word into unaligned buffer
+ */
+static wws_ret_t get_word(wws_memory_t *m, unsigned int addr, char *dst, unsigned int width)
+{
+  const wws_memory_inf_t *inf = m->interface;
+  unsigned int            b   = 0;
+  wws_ret_t               ret = WWS_RET_OK;
+  if (width == 4) {
+    int word;
+    if (inf->get32) ret = inf->get32(m->inst, addr, &word);
+    else
+      ret = inf->read32(m->inst, addr, 1, &word, &b);
+    memcpy(dst, &word, 4);
+    return ret;
+  }
+  short word;
+  if (inf->get16) ret = inf->get16(m->inst, addr, &word);
+  else
+    ret = inf->read16(m->inst, addr, 1, &word, &b);
+  memcpy(dst, &word, 2);
+  return ret;
+}
+
+/**
+ * @brief write without block op: put8 for ragged edges, widest word for aligned middle
+ * @note bounds checked by caller
+ */
+static wws_ret_t bulk_write(
+  wws_memory_t *m, unsigned int offset, const char *data, unsigned int len, unsigned int *written)
+{
+  const wws_memory_inf_t *inf   = m->interface;
+  const unsigned int      width = put_width(inf);
+  const unsigned int      addr  = m->base + offset;
+  unsigned int            l     = 0;
+  wws_ret_t               ret   = WWS_RET_OK;
+
+  /** head until aligned */
+  for (; (l < len) && ((addr + l) & (width - 1)); l++) {
+    wws_assert(inf->put8);
+    if ((ret = inf->put8(m->inst, addr + l, data[l])) != WWS_RET_OK) goto done;
+  }
+
+  /** aligned middle */
+  if ((width > 1) && ((len - l) >= width)) {
+    const unsigned int words = (len - l) / width;
+    const bool         block = (((uintptr_t) &data[l] & (width - 1)) == 0) &&
+                       ((width == 4) ? (inf->write32 != 0) : (inf->write16 != 0));
+    if (block) {
+      unsigned int w = 0;
+      ret            = (width == 4) ?
+                         inf->write32(m->inst, addr + l, (const int *) &data[l], words, &w) :
+                         inf->write16(m->inst, addr + l, (const short *) &data[l], words, &w);
+      l += ((ret == WWS_RET_OK) ? words : w) * width;
+      if (ret != WWS_RET_OK) goto done;
+    }
+    else {
+      for (unsigned int end = l + words * width; l < end; l += width) {
+        if ((ret = put_word(m, addr + l, &data[l], width)) != WWS_RET_OK) goto done;
+      }
+    }
+  }
+
+  /** tail */
+  for (; l < len; l++) {
+    wws_assert(inf->put8);
+    if ((ret = inf->put8(m->inst, addr + l, data[l])) != WWS_RET_OK) break;
+  }
+
+done:
+  if (written) (*written) = l;
+  return ret;
+}
+
+/**
+ * @brief read without block op: get8 for ragged edges, widest word for aligned middle
+ * @note bounds checked by caller
+ */
+static wws_ret_t
+bulk_read(wws_memory_t *m, unsigned int offset, unsigned int size, char *buf, unsigned int *buffered)
+{
+  const wws_memory_inf_t *inf   = m->interface;
+  const unsigned int      width = get_width(inf);
+  const unsigned int      addr  = m->base + offset;
+  unsigned int            l     = 0;
+  wws_ret_t               ret   = WWS_RET_OK;
+
+  /** head until aligned */
+  for (; (l < size) && ((addr + l) & (width - 1)); l++) {
+    wws_assert(inf->get8);
+    if ((ret = inf->get8(m->inst, addr + l, &buf[l])) != WWS_RET_OK) goto done;
+  }
+
+  /** aligned middle */
+  if ((width > 1) && ((size - l) >= width)) {
+    const unsigned int words = (size - l) / width;
+    const bool         block = (((uintptr_t) &buf[l] & (width - 1)) == 0) &&
+                       ((width == 4) ? (inf->read32 != 0) : (inf->read16 != 0));
+    if (block) {
+      unsigned int b = 0;
+      ret            = (width == 4) ? inf->read32(m->inst, addr + l, words, (int *) &buf[l], &b) :
+                                      inf->read16(m->inst, addr + l, words, (short *) &buf[l], &b);
+      l += ((ret == WWS_RET_OK) ? words : b) * width;
+      if (ret != WWS_RET_OK) goto done;
+    }
+    else {
+      for (unsigned int end = l + words * width; l < end; l += width) {
+        if ((ret = get_word(m, addr + l, &buf[l], width)) != WWS_RET_OK) goto done;
+      }
+    }
+  }
+
+  /** tail */
+  for (; l < size; l++) {
+    wws_assert(inf->get8);
+    if ((ret = inf->get8(m->inst, addr + l, &buf[l])) != WWS_RET_OK) break;
+  }
+
+done:
+  if (buffered) (*buffered) = l;
+  return ret;
+}
+
 wws_ret_t wws_memory_put8(wws_memory_t *m, unsigned int offset, char data)
 {
-  wws_assert(m && m->interface && m->interface->put8);
+  wws_assert(m && (m->mapped || (m->interface && m->interface->put8)));
   if ((offset + 1) > m->size) return WWS_RET_ERR_OVERSIZE;
+  if (m->mapped) {
+    *(char *) mapped_ptr(m, offset) = data;
+    return WWS_RET_OK;
+  }
   return m->interface->put8(m->inst, m->base + offset, data);
 }
 
 wws_ret_t wws_memory_put16(wws_memory_t *m, unsigned int offset, short data)
 {
-  wws_assert(m && m->interface);
-  if (m->interface->put16 == 0)
+  wws_assert(m && (m->mapped || m->interface));
+  if (m->mapped || (m->interface->put16 == 0))
     return wws_memory_write8(m,
                              offset,
                              (union {
@@ -33,8 +217,8 @@ wws_ret_t wws_memory_put16(wws_memory_t *m, unsigned int offset, short data)
 
 wws_ret_t wws_memory_put32(wws_memory_t *m, unsigned int offset, int data)
 {
-  wws_assert(m && m->interface);
-  if (m->interface->put32 == 0)
+  wws_assert(m && (m->mapped || m->interface));
+  if (m->mapped || (m->interface->put32 == 0))
     return wws_memory_write8(m,
                              offset,
                              (union {
@@ -51,73 +235,71 @@ wws_ret_t wws_memory_put32(wws_memory_t *m, unsigned int offset, int data)
 wws_ret_t wws_memory_write8(
   wws_memory_t *m, unsigned int offset, const char *data, unsigned int len, unsigned int *written)
 {
-  wws_assert(m && m->interface);
-  if (m->interface->write8) {
-    if ((offset + (len + 1) * 1) > m->size) return WWS_RET_ERR_OVERSIZE;
-    return m->interface->write8(m->inst, m->base + offset, data, len, written);
-  }
-  unsigned int l   = 0;
-  wws_ret_t    ret = WWS_RET_OK;
-  for (; l < len; l++) {
-    if ((ret = wws_memory_put8(m, offset + l * 1, data[l])) != WWS_RET_OK) break;
+  wws_assert(m && (m->mapped || m->interface));
+  if ((offset + len * 1) > m->size) return WWS_RET_ERR_OVERSIZE;
+  if (m->mapped) {
+    memcpy(mapped_ptr(m, offset), data, len);
+    if (written) (*written) = len;
+    return WWS_RET_OK;
   }
-  (*written) = l;
-  return ret;
+  if (m->interface->write8)
+    return m->interface->write8(m->inst, m->base + offset, data, len, written);
+  return bulk_write(m, offset, data, len, written);
 }
 
 wws_ret_t wws_memory_write16(
   wws_memory_t *m, unsigned int offset, const short *data, unsigned int len, unsigned int *written)
 {
-  wws_assert(m && m->interface);
-  if (m->interface->write16) {
-    if ((offset + (len + 1) * 2) > m->size) return WWS_RET_ERR_OVERSIZE;
-    return m->interface->write16(m->inst, m->base + offset, data, len, written);
-  }
-  unsigned int l   = 0;
-  wws_ret_t    ret = WWS_RET_OK;
-  for (; l < len; l++) {
-    if ((ret = wws_memory_put16(m, offset + l * 2, data[l])) != WWS_RET_OK) break;
+  wws_assert(m && (m->mapped || m->interface));
+  if ((offset + len * 2) > m->size) return WWS_RET_ERR_OVERSIZE;
+  if (m->mapped || (m->interface->write16 == 0)) {
+    unsigned int l   = 0;
+    wws_ret_t    ret = wws_memory_write8(m, offset, (const char *) data, len * 2, &l);
+    if (written) (*written) = l / 2;
+    return ret;
   }
-  (*written) = l;
-  return ret;
+  return m->interface->write16(m->inst, m->base + offset, data, len, written);
 }
 
 wws_ret_t wws_memory_write32(
   wws_memory_t *m, unsigned int offset, const int *data, unsigned int len, unsigned int *written)
 {
-  wws_assert(m && m->interface);
-  if (m->interface->write32) {
-    if ((offset + (len + 1) * 4) > m->size) return WWS_RET_ERR_OVERSIZE;
-    return m->interface->write32(m->inst, m->base + offset, data, len, written);
+  wws_assert(m && (m->mapped || m->interface));
+  if ((offset + len * 4) > m->size) return WWS_RET_ERR_OVERSIZE;
+  if (m->mapped || (m->interface->write32 == 0)) {
+    unsigned int l   = 0;
+    wws_ret_t    ret = wws_memory_write8(m, offset, (const char *) data, len * 4, &l);
+    if (written) (*written) = l / 4;
+    return ret;
   }
-  unsigned int l   = 0;
-  wws_ret_t    ret = WWS_RET_OK;
-  for (; l < len; l++) {
-    if ((ret = wws_memory_put32(m, offset + l * 4, data[l])) != WWS_RET_OK) break;
-  }
-  (*written) = l;
-  return ret;
+  return m->interface->write32(m->inst, m->base + offset, data, len, written);
 }
 
 wws_ret_t wws_memory_get8(wws_memory_t *m, unsigned int offset, char *buf)
 {
-  wws_assert(m && m->interface && m->interface->get8);
+  wws_assert(m && (m->mapped || (m->interface && m->interface->get8)));
   if ((offset + 1) > m->size) return WWS_RET_ERR_OVERSIZE;
+  if (m->mapped) {
+    *buf = *(const char *) mapped_ptr(m, offset);
+    return WWS_RET_OK;
+  }
   return m->interface->get8(m->inst, m->base + offset, buf);
 }
 
 wws_ret_t wws_memory_get16(wws_memory_t *m, unsigned int offset, short *buf)
 {
-  wws_assert(m && m->interface);
-  if (m->interface->get16 == 0) return wws_memory_read8(m, offset, 2, (char *) buf, 0);
+  wws_assert(m && (m->mapped || m->interface));
+  if (m->mapped || (m->interface->get16 == 0))
+    return wws_memory_read8(m, offset, 2, (char *) buf, 0);
   if ((offset + 2) > m->size) return WWS_RET_ERR_OVERSIZE;
   return m->interface->get16(m->inst, m->base + offset, buf);
 }
 
 wws_ret_t wws_memory_get32(wws_memory_t *m, unsigned int offset, int *buf)
 {
-  wws_assert(m && m->interface);
-  if (m->interface->get32 == 0) return wws_memory_read8(m, offset, 4, (char *) buf, 0);
+  wws_assert(m && (m->mapped || m->interface));
+  if (m->mapped || (m->interface->get32 == 0))
+    return wws_memory_read8(m, offset, 4, (char *) buf, 0);
   if ((offset + 4) > m->size) return WWS_RET_ERR_OVERSIZE;
   return m->interface->get32(m->inst, m->base + offset, buf);
 }
@@ -125,50 +307,193 @@ wws_ret_t wws_memory_get32(wws_memory_t *m, unsigned int offset, int *buf)
 wws_ret_t wws_memory_read8(
   wws_memory_t *m, unsigned int offset, unsigned int size, char *buf, unsigned int *buffered)
 {
-  wws_assert(m && m->interface);
-  if (m->interface->read8) {
-    if ((offset + (size + 1) * 1) > m->size) return WWS_RET_ERR_OVERSIZE;
-    return m->interface->read8(m->inst, m->base + offset, size, buf, buffered);
+  wws_assert(m && (m->mapped || m->interface));
+  if ((offset + size * 1) > m->size) return WWS_RET_ERR_OVERSIZE;
+  if (m->mapped) {
+    memcpy(buf, mapped_ptr(m, offset), size);
+    if (buffered) (*buffered) = size;
+    return WWS_RET_OK;
   }
-  unsigned int l   = 0;
-  wws_ret_t    ret = WWS_RET_OK;
-  for (; l < size; l++) {
-    if ((ret = wws_memory_get8(m, offset + l * 1, &buf[l])) != WWS_RET_OK) break;
-  }
-  (*buffered) = l;
-  return ret;
+  if (m->interface->read8)
+    return m->interface->read8(m->inst, m->base + offset, size, buf, buffered);
+  return bulk_read(m, offset, size, buf, buffered);
 }
 
 wws_ret_t wws_memory_read16(
   wws_memory_t *m, unsigned int offset, unsigned int size, short *buf, unsigned int *buffered)
 {
-  wws_assert(m && m->interface);
-  if (m->interface->read16) {
-    if ((offset + (size + 1) * 2) > m->size) return WWS_RET_ERR_OVERSIZE;
-    return m->interface->read16(m->inst, m->base + offset, size, buf, buffered);
+  wws_assert(m && (m->mapped || m->interface));
+  if ((offset + size * 2) > m->size) return WWS_RET_ERR_OVERSIZE;
+  if (m->mapped || (m->interface->read16 == 0)) {
+    unsigned int l   = 0;
+    wws_ret_t    ret = wws_memory_read8(m, offset, size * 2, (char *) buf, &l);
+    if (buffered) (*buffered) = l / 2;
+    return ret;
   }
-  unsigned int l   = 0;
-  wws_ret_t    ret = WWS_RET_OK;
-  for (; l < size; l++) {
-    if ((ret = wws_memory_get16(m, offset + l * 2, &buf[l])) != WWS_RET_OK) break;
-  }
-  (*buffered) = l;
-  return ret;
+  return m->interface->read16(m->inst, m->base + offset, size, buf, buffered);
 }
 
 wws_ret_t wws_memory_read32(
   wws_memory_t *m, unsigned int offset, unsigned int size, int *buf, unsigned int *buffered)
 {
-  wws_assert(m && m->interface);
-  if (m->interface->read32) {
-    if ((offset + (size + 1) * 4) > m->size) return WWS_RET_ERR_OVERSIZE;
-    return m->interface->read32(m->inst, m->base + offset, size, buf, buffered);
+  wws_assert(m && (m->mapped || m->interface));
+  if ((offset + size * 4) > m->size) return WWS_RET_ERR_OVERSIZE;
+  if (m->mapped || (m->interface->read32 == 0)) {
+    unsigned int l   = 0;
+    wws_ret_t    ret = wws_memory_read8(m, offset, size * 4, (char *) buf, &l);
+    if (buffered) (*buffered) = l / 4;
+    return ret;
   }
-  unsigned int l   = 0;
-  wws_ret_t    ret = WWS_RET_OK;
-  for (; l < size; l++) {
-    if ((ret = wws_memory_get32(m, offset + l * 4, &buf[l])) != WWS_RET_OK) break;
+  return m->interface->read32(m->inst, m->base + offset, size, buf, buffered);
+}
+
+/**
+ * @brief check every segment inside region
+ */
+static bool iov_valid(wws_memory_t *m, const wws_memory_iov_t iov[])
+{
+  for (int i = 0; iov[i].len; i++) {
+    if ((iov[i].offset + iov[i].len) > m->size) return false;
+  }
+  return true;
+}
+
+wws_ret_t wws_memory_writev(wws_memory_t *m, const wws_memory_iov_t iov[], unsigned int *written)
+{
+  wws_assert(m && (m->mapped || m->interface) && iov);
+  if (!iov_valid(m, iov)) return WWS_RET_ERR_OVERSIZE;
+  if (!m->mapped && m->interface->writev)
+    return m->interface->writev(m->inst, m->base, iov, written);
+
+  unsigned int total = 0;
+  wws_ret_t    ret   = WWS_RET_OK;
+  for (int i = 0; iov[i].len; i++) {
+    unsigned int l = 0;
+    ret            = wws_memory_write8(m, iov[i].offset, iov[i].cptr, iov[i].len, &l);
+    total += l;
+    if (ret != WWS_RET_OK) break;
+  }
+  if (written) (*written) = total;
+  return ret;
+}
+
+wws_ret_t wws_memory_readv(wws_memory_t *m, const wws_memory_iov_t iov[], unsigned int *buffered)
+{
+  wws_assert(m && (m->mapped || m->interface) && iov);
+  if (!iov_valid(m, iov)) return WWS_RET_ERR_OVERSIZE;
+  if (!m->mapped && m->interface->readv)
+    return m->interface->readv(m->inst, m->base, iov, buffered);
+
+  unsigned int total = 0;
+  wws_ret_t    ret   = WWS_RET_OK;
+  for (int i = 0; iov[i].len; i++) {
+    unsigned int l = 0;
+    ret            = wws_memory_read8(m, iov[i].offset, iov[i].len, iov[i].ptr, &l);
+    total += l;
+    if (ret != WWS_RET_OK) break;
   }
-  (*buffered) = l;
+  if (buffered) (*buffered) = total;
   return ret;
 }
+
+static inline wws_memory_req_t *req_at(wws_memory_queue_t *q, unsigned int i)
+{
+  return &q->reqs[(q->_head + i) % q->num];
+}
+
+/**
+ * @brief release first request and notify
+ */
+static void req_pop(wws_memory_t *m, wws_ret_t ret)
+{
+  wws_memory_queue_t *q   = m->queue;
+  wws_memory_req_t    req = *req_at(q, 0);
+
+  /** release before callback, so callback can submit again */
+  q->_head = (q->_head + 1) % q->num;
+  q->_count--;
+
+  wws_event(WWS_COMP_MEMORY, WWS_EVT_DONE, m, &req, ret);
+  if (req.callback) req.callback(ret, m, &req);
+}
+
+wws_ret_t wws_memory_submit(wws_memory_t         *m,
+                            wws_xfer_t            xfer,
+                            unsigned int          offset,
+                            void                 *buf,
+                            unsigned int          len,
+                            wws_memory_callback_t callback)
+{
+  wws_assert(m && m->queue && m->queue->reqs && m->queue->num && buf);
+  wws_assert((xfer == WWS_XFER_WRITE) || (xfer == WWS_XFER_READ));
+
+  wws_memory_queue_t *q = m->queue;
+  if ((offset + len) > m->size) return WWS_RET_ERR_OVERSIZE;
+  if (q->_count == q->num) return WWS_RET_ERR_BUSY;
+
+  /** copied in, as const xfer can not be assigned */
+  memcpy(req_at(q, q->_count),
+         &(wws_memory_req_t){
+           .xfer = xfer, .offset = offset, .buf = buf, .len = len, .done = 0, .callback = callback },
+         sizeof(wws_memory_req_t));
+  q->_count++;
+  return WWS_RET_OK;
+}
+
+unsigned int wws_memory_step(wws_memory_t *m)
+{
+  wws_assert(m && m->queue);
+
+  wws_memory_queue_t *q = m->queue;
+  if (q->_count == 0) return 0;
+
+  wws_memory_req_t  *head  = req_at(q, 0);
+  const unsigned int start = head->offset + head->done;
+  const bool         merge = q->buffer && q->step;
+  unsigned int       room  = head->len - head->done;
+  unsigned int       total = 0, n = 0;
+
+  if (q->step) room = q->step - (start % q->step);
+
+  /** gather head and following sequential requests of same xfer, in queue order */
+  for (unsigned int end = start; n < q->_count;) {
+    wws_memory_req_t *r = req_at(q, n);
+    if (n && (!merge || (r->xfer != head->xfer) || (r->offset != end))) break;
+
+    unsigned int l = r->len - r->done;
+    if (l > (room - total)) l = room - total;
+    if (merge && (r->xfer == WWS_XFER_WRITE)) memcpy(&q->buffer[total], &r->data[r->done], l);
+    total += l;
+    end += l;
+    n++;
+    if (total == room) break;
+  }
+
+  char     *ptr = merge ? q->buffer : &head->buf[head->done];
+  wws_ret_t ret = (head->xfer == WWS_XFER_WRITE) ? wws_memory_write8(m, start, ptr, total, 0) :
+                                                   wws_memory_read8(m, start, total, ptr, 0);
+
+  /** scatter and complete */
+  for (unsigned int i = 0, used = 0; i < n; i++) {
+    wws_memory_req_t *r = req_at(q, 0);
+    unsigned int      l = r->len - r->done;
+    if (l > (total - used)) l = total - used;
+    if (merge && (r->xfer == WWS_XFER_READ) && (ret == WWS_RET_OK))
+      memcpy(&r->buf[r->done], &q->buffer[used], l);
+    r->done += l;
+    used += l;
+
+    if (ret != WWS_RET_OK) req_pop(m, ret);
+    else if (r->done == r->len)
+      req_pop(m, WWS_RET_OK);
+    else
+      break;
+  }
+
+  return q->_count;
+}
+
+void ___wws_memory_queue_service_callback(wws_phase_t on, wws_service_t *serv)
+{
+  if (on == WWS_ON_ROUTINE) wws_memory_step(serv->inst);
+}
@@ -0,0 +1,171 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#include <string.h>
+
+#include <wws_mcu/memory_cache.h>
+#include <wws_mcu/debug.h>
+
+wws_comp_t         WWS_COMP_MEMORY_CACHE = "MemoryCache";
+WWS_WEAK wws_evt_t WWS_EVT_MISS          = "MISS";
+WWS_WEAK wws_evt_t WWS_EVT_FLUSH         = "FLUSH";
+
+WWS_WEAK wws_ret_t WWS_RET_OK = "OK";
+
+static inline char *line_data(wws_memory_cache_t *cache, wws_memory_cache_line_t *line)
+{
+  return &cache->buffer[(line - cache->lines) * cache->page_size];
+}
+
+/**
+ * @brief length of page, last page may be cut by size of backing memory
+ */
+static inline unsigned int page_len(wws_memory_cache_t *cache, unsigned int page)
+{
+  const unsigned int start = page * cache->page_size;
+  const unsigned int rest  = cache->memory->size - start;
+  return rest < cache->page_size ? rest : cache->page_size;
+}
+
+static wws_ret_t line_flush(wws_memory_cache_t *cache, wws_memory_cache_line_t *line)
+{
+  if (!line->valid || !line->dirty) return WWS_RET_OK;
+
+  wws_event(WWS_COMP_MEMORY_CACHE, WWS_EVT_FLUSH, cache, line);
+  wws_ret_t ret = wws_memory_write8(cache->memory,
+                                    line->page * cache->page_size,
+                                    line_data(cache, line),
+                                    page_len(cache, line->page),
+                                    0);
+  if (ret == WWS_RET_OK) line->dirty = 0;
+  return ret;
+}
+
+/**
+ * @brief get line of page, allocate by LRU if missed
+ * @param fill fetch page from backing memory when missed
+ */
+static wws_ret_t
+line_get(wws_memory_cache_t *cache, unsigned int page, bool fill, wws_memory_cache_line_t **out)
+{
+  wws_memory_cache_line_t *victim = &cache->lines[0];
+  wws_ret_t                ret    = WWS_RET_OK;
+
+  for (unsigned int i = 0; i < cache->num; i++) {
+    wws_memory_cache_line_t *line = &cache->lines[i];
+    if (line->valid && (line->page == page)) {
+      line->stamp = ++cache->_stamp;
+      *out        = line;
+      return WWS_RET_OK;
+    }
+    /** prefer empty line, otherwise least recently used */
+    if (!victim->valid) continue;
+    if (!line->valid || (line->stamp < victim->stamp)) victim = line;
+  }
+
+  wws_event(WWS_COMP_MEMORY_CACHE, WWS_EVT_MISS, cache, &page);
+  if ((ret = line_flush(cache, victim)) != WWS_RET_OK) return ret;
+
+  victim->valid = 0;
+  if (fill) {
+    ret = wws_memory_read8(cache->memory,
+                           page * cache->page_size,
+                           page_len(cache, page),
+                           line_data(cache, victim),
+                           0);
+    if (ret != WWS_RET_OK) return ret;
+  }
+
+  victim->page  = page;
+  victim->valid = 1;
+  victim->dirty = 0;
+  victim->stamp = ++cache->_stamp;
+  *out          = victim;
+  return WWS_RET_OK;
+}
+
+wws_ret_t wws_memory_cache_flush(wws_memory_cache_t *cache)
+{
+  wws_assert(cache && cache->memory && cache->lines);
+
+  wws_ret_t ret = WWS_RET_OK;
+  for (unsigned int i = 0; i < cache->num; i++) {
+    if ((ret = line_flush(cache, &cache->lines[i])) != WWS_RET_OK) break;
+  }
+  return ret;
+}
+
+static wws_ret_t
+mem_write8(void *inst, unsigned int addr, const char *data, unsigned int len, unsigned int *written)
+{
+  wws_memory_cache_t *cache = inst;
+  wws_assert(cache && cache->memory && cache->buffer && cache->lines && cache->page_size);
+
+  unsigned int wlen = 0;
+  wws_ret_t    ret  = WWS_RET_OK;
+
+  while (wlen < len) {
+    const unsigned int       page = (addr + wlen) / cache->page_size;
+    const unsigned int       off  = (addr + wlen) % cache->page_size;
+    unsigned int             wl   = cache->page_size - off;
+    wws_memory_cache_line_t *line = 0;
+    if (wl > (len - wlen)) wl = len - wlen;
+
+    /** whole page overwritten, no need to fetch */
+    ret = line_get(cache, page, (off != 0) || (wl != page_len(cache, page)), &line);
+    if (ret != WWS_RET_OK) break;
+
+    memcpy(line_data(cache, line) + off, &data[wlen], wl);
+    line->dirty = 1;
+    wlen += wl;
+  }
+
+  if (written) *written = wlen;
+  return ret;
+}
+
+static wws_ret_t mem_put8(void *inst, unsigned int addr, char data)
+{
+  return mem_write8(inst, addr, &data, 1, 0);
+}
+
+static wws_ret_t
+mem_read8(void *inst, unsigned int addr, unsigned int size, char *buf, unsigned int *buffered)
+{
+  wws_memory_cache_t *cache = inst;
+  wws_assert(cache && cache->memory && cache->buffer && cache->lines && cache->page_size);
+
+  unsigned int rlen = 0;
+  wws_ret_t    ret  = WWS_RET_OK;
+
+  while (rlen < size) {
+    const unsigned int       page = (addr + rlen) / cache->page_size;
+    const unsigned int       off  = (addr + rlen) % cache->page_size;
+    unsigned int             rl   = cache->page_size - off;
+    wws_memory_cache_line_t *line = 0;
+    if (rl > (size - rlen)) rl = size - rlen;
+
+    if ((ret = line_get(cache, page, true, &line)) != WWS_RET_OK) break;
+
+    memcpy(&buf[rlen], line_data(cache, line) + off, rl);
+    rlen += rl;
+  }
+
+  if (buffered) *buffered = rlen;
+  return ret;
+}
+
+static wws_ret_t mem_get8(void *inst, unsigned int addr, char *buf)
+{
+  return mem_read8(inst, addr, 1, buf, 0);
+}
+
+const wws_memory_inf_t wws_memory_cache_interface = {
+  .put8   = mem_put8,
+  .write8 = mem_write8,
+  .get8   = mem_get8,
+  .read8  = mem_read8,
+};
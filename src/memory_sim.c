@@ -0,0 +1,151 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define HAS_MMAP (1)
+#endif /** posix */
+
+#include <wws_mcu/memory_sim.h>
+#include <wws_mcu/debug.h>
+
+wws_comp_t         WWS_COMP_MEMORY_SIM = "MemorySim";
+WWS_WEAK wws_evt_t WWS_EVT_FAULT       = "FAULT";
+
+WWS_WEAK wws_ret_t WWS_RET_OK        = "OK";
+WWS_WEAK wws_ret_t WWS_RET_ERR_FAULT = "ERR_FAULT";
+WWS_WEAK wws_ret_t WWS_RET_ERR_OTHER = "ERR_OTHER";
+
+static inline unsigned int page_size(wws_memory_sim_t *sim)
+{
+  return sim->page_size ? sim->page_size : sim->size;
+}
+
+/**
+ * @brief account latency (and wear for writes) of one access
+ */
+static void account(wws_memory_sim_t *sim, unsigned int addr, unsigned int len, bool write)
+{
+  sim->elapsed += sim->latency.op + (unsigned long long) sim->latency.byte * len;
+  if (!write || (len == 0)) return;
+
+  const unsigned int ps = page_size(sim);
+  for (unsigned int p = addr / ps; p <= (addr + len - 1) / ps; p++) {
+    sim->elapsed += sim->latency.page;
+    if (sim->wear) sim->wear[p]++;
+  }
+}
+
+wws_ret_t wws_memory_sim_open(wws_memory_sim_t *sim, const char *path, unsigned int size)
+{
+  wws_assert(sim && path && size);
+#ifdef HAS_MMAP
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return WWS_RET_ERR_OTHER;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return WWS_RET_ERR_OTHER;
+  }
+  const unsigned int exist = st.st_size < size ? (unsigned int) st.st_size : size;
+  if ((st.st_size < size) && (ftruncate(fd, size) != 0)) {
+    close(fd);
+    return WWS_RET_ERR_OTHER;
+  }
+
+  void *data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    close(fd);
+    return WWS_RET_ERR_OTHER;
+  }
+
+  /** new area is erased */
+  memset((char *) data + exist, 0xFF, size - exist);
+
+  sim->data    = data;
+  sim->size    = size;
+  sim->_fd     = fd;
+  sim->_mapped = 1;
+  return WWS_RET_OK;
+#else
+  return WWS_RET_ERR_OTHER;
+#endif /** HAS_MMAP */
+}
+
+void wws_memory_sim_close(wws_memory_sim_t *sim)
+{
+  wws_assert(sim);
+#ifdef HAS_MMAP
+  if (!sim->_mapped) return;
+  msync(sim->data, sim->size, MS_SYNC);
+  munmap(sim->data, sim->size);
+  close(sim->_fd);
+  sim->data    = 0;
+  sim->_mapped = 0;
+#endif /** HAS_MMAP */
+}
+
+static wws_ret_t
+mem_write8(void *inst, unsigned int addr, const char *data, unsigned int len, unsigned int *written)
+{
+  wws_memory_sim_t *sim = inst;
+  wws_assert(sim && sim->data && ((addr + len) <= sim->size));
+
+  unsigned int wl  = len;
+  wws_ret_t    ret = WWS_RET_OK;
+
+  if (sim->fail) {
+    const unsigned int rest = sim->fail_after > sim->written ? sim->fail_after - sim->written : 0;
+    if (wl > rest) {
+      wl  = rest;
+      ret = WWS_RET_ERR_FAULT;
+      wws_event(WWS_COMP_MEMORY_SIM, WWS_EVT_FAULT, sim, &addr, &wl);
+    }
+  }
+
+  memcpy(&sim->data[addr], data, wl);
+  account(sim, addr, wl, true);
+  sim->written += wl;
+
+  if (written) *written = wl;
+  return ret;
+}
+
+static wws_ret_t mem_put8(void *inst, unsigned int addr, char data)
+{
+  return mem_write8(inst, addr, &data, 1, 0);
+}
+
+static wws_ret_t
+mem_read8(void *inst, unsigned int addr, unsigned int size, char *buf, unsigned int *buffered)
+{
+  wws_memory_sim_t *sim = inst;
+  wws_assert(sim && sim->data && ((addr + size) <= sim->size));
+
+  memcpy(buf, &sim->data[addr], size);
+  account(sim, addr, size, false);
+
+  if (buffered) *buffered = size;
+  return WWS_RET_OK;
+}
+
+static wws_ret_t mem_get8(void *inst, unsigned int addr, char *buf)
+{
+  return mem_read8(inst, addr, 1, buf, 0);
+}
+
+const wws_memory_inf_t wws_memory_sim_interface = {
+  .put8   = mem_put8,
+  .write8 = mem_write8,
+  .get8   = mem_get8,
+  .read8  = mem_read8,
+};
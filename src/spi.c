@@ -5,41 +5,368 @@
  * Licensed under the MIT license. See LICENSE file in the project root for details.
  */
 #include <wws_mcu/spi.h>
+#include <wws_mcu/ringbuffer.h>
+#include <wws_mcu/time.h>
 #include <wws_mcu/debug.h>
 
-wws_comp_t         WWS_COMP_SPI  = "SPI";
-WWS_WEAK wws_evt_t WWS_EVT_START = "START";
-WWS_WEAK wws_evt_t WWS_EVT_XFER  = "XFER";
-WWS_WEAK wws_evt_t WWS_EVT_STOP  = "STOP";
+wws_comp_t         WWS_COMP_SPI      = "SPI";
+WWS_WEAK wws_evt_t WWS_EVT_START    = "START";
+WWS_WEAK wws_evt_t WWS_EVT_XFER     = "XFER";
+WWS_WEAK wws_evt_t WWS_EVT_STOP     = "STOP";
+WWS_WEAK wws_evt_t WWS_EVT_UNDERRUN = "UNDERRUN";
 
-WWS_WEAK wws_ret_t WWS_RET_OK        = "OK";
-WWS_WEAK wws_ret_t WWS_RET_ERR_OTHER = "ERR_OTHER";
+WWS_WEAK wws_ret_t WWS_RET_OK          = "OK";
+WWS_WEAK wws_ret_t WWS_RET_ERR_BUSY    = "ERR_BUSY";
+WWS_WEAK wws_ret_t WWS_RET_ERR_OTHER   = "ERR_OTHER";
+WWS_WEAK wws_ret_t WWS_RET_ERR_TIMEOUT = "ERR_TIMEOUT";
 
+/** wait of exchange in progress when stream stopped */
+#define STOP_TIMEOUT (WWS_MS(100))
 
-wws_ret_t wws_spi_xfer(wws_spi_dev_t *dev, wws_spi_xfer_t xfers[])
+
+/**
+ * @brief start bus, reprogramming only fields changed since last applied config
+ */
+static wws_ret_t bus_start(wws_spi_dev_t *dev)
 {
-  wws_assert(dev && dev->spi && dev->spi->interface);
+  wws_spi_t *const     spi     = dev->spi;
+  const wws_spi_cfg_t *cfg     = &dev->cfg;
+  unsigned int         changed = WWS_SPI_CHANGED_ALL;
+  wws_ret_t            ret     = WWS_RET_OK;
 
-  wws_ret_t ret = WWS_RET_OK;
+  if (!spi->interface->start_changed) return spi->interface->start(spi->inst, &dev->cfg);
 
+  if (spi->_applied) {
+    changed = ((spi->_speed != cfg->speed) ? WWS_SPI_CHANGED_SPEED : 0) |
+              ((spi->_cpol != cfg->cpol) ? WWS_SPI_CHANGED_CPOL : 0) |
+              ((spi->_cpha != cfg->cpha) ? WWS_SPI_CHANGED_CPHA : 0) |
+              ((spi->_dummy != cfg->dummy) ? WWS_SPI_CHANGED_DUMMY : 0);
+  }
+
+  ret           = spi->interface->start_changed(spi->inst, &dev->cfg, changed);
+  spi->_applied = (ret == WWS_RET_OK);
+  spi->_speed   = cfg->speed;
+  spi->_cpol    = cfg->cpol;
+  spi->_cpha    = cfg->cpha;
+  spi->_dummy   = cfg->dummy;
+  return ret;
+}
+
+/**
+ * @brief start bus and assert cs of device
+ */
+static wws_ret_t dev_select(wws_spi_dev_t *dev)
+{
   wws_event(WWS_COMP_SPI, WWS_EVT_START, dev);
-  ret = dev->spi->interface->start(dev->spi->inst, &dev->cfg);
+  wws_ret_t ret = bus_start(dev);
   if ((ret == WWS_RET_OK) && dev->cs) {
     wws_logic_write(dev->cs, WWS_LOW);
     wws_delay(dev->cfg.delay.start);
+    if (dev->cfg.delay.start_us) wws_delay_us(dev->cfg.delay.start_us);
   }
+  return ret;
+}
 
-  for (int i = 0; (ret == WWS_RET_OK) && xfers[i].len; i++) {
-    wws_event(WWS_COMP_SPI, WWS_EVT_XFER, dev, &xfers[i]);
-    ret = dev->spi->interface->exchange(dev->spi->inst, &dev->cfg, &xfers[i]);
-  }
-
+/**
+ * @brief release cs of device and stop bus
+ */
+static void dev_release(wws_spi_dev_t *dev)
+{
   wws_event(WWS_COMP_SPI, WWS_EVT_STOP, dev);
   if (dev->cs) {
     wws_logic_write(dev->cs, WWS_HIGH);
     wws_delay(dev->cfg.delay.stop);
+    if (dev->cfg.delay.stop_us) wws_delay_us(dev->cfg.delay.stop_us);
   }
   dev->spi->interface->stop(dev->spi->inst, &dev->cfg);
+}
 
+/**
+ * @brief run transaction in place
+ */
+static wws_ret_t xfer_run(wws_spi_dev_t *dev, wws_spi_xfer_t xfers[])
+{
+  wws_ret_t ret = dev_select(dev);
+
+  for (int i = 0; (ret == WWS_RET_OK) && xfers[i].len; i++) {
+    wws_event(WWS_COMP_SPI, WWS_EVT_XFER, dev, &xfers[i]);
+    ret = dev->spi->interface->exchange(dev->spi->inst, &dev->cfg, &xfers[i]);
+  }
+
+  dev_release(dev);
   return ret;
 }
+
+wws_ret_t wws_spi_xfer(wws_spi_dev_t *dev, wws_spi_xfer_t xfers[])
+{
+  wws_assert(dev && dev->spi && dev->spi->interface);
+
+  /** bus owned by stream or queue */
+  if (dev->spi->_stream || wws_spi_is_busy(dev->spi)) return WWS_RET_ERR_BUSY;
+
+  return xfer_run(dev, xfers);
+}
+
+/**
+ * @brief begin exchange of next buffer, in order
+ */
+static void stream_send(wws_spi_stream_t *stream)
+{
+  wws_spi_dev_t *const dev = stream->dev;
+  const unsigned int   i   = stream->_send;
+
+  stream->_xfer = (wws_spi_xfer_t){
+    .data = stream->bufs[i], .len = stream->_len[i], .buf = stream->rx[i]
+  };
+  stream->_busy = 1;
+  if (dev->spi->interface->exchange_async(dev->spi->inst, &dev->cfg, &stream->_xfer) !=
+      WWS_RET_OK) {
+    wws_spi_on_exchange(dev->spi, WWS_RET_ERR_OTHER);
+  }
+}
+
+/**
+ * @brief chain next xfer of queued transaction in interrupt, or mark it done for service
+ */
+static void queue_on_exchange(wws_spi_t *spi, wws_ret_t ret)
+{
+  wws_spi_queue_t *const q = spi->queue;
+  if (!q || !q->_active || q->_done) return;
+
+  const wws_spi_req_t *req = &q->reqs[wws_ring_index(q->_head, q->num)];
+  if ((ret == WWS_RET_OK) && req->xfers[++q->_xfer].len) {
+    wws_event(WWS_COMP_SPI, WWS_EVT_XFER, req->dev, &req->xfers[q->_xfer]);
+    ret = spi->interface->exchange_async(spi->inst, &req->dev->cfg, &req->xfers[q->_xfer]);
+    if (ret == WWS_RET_OK) return;
+  }
+  q->_ret  = ret;
+  q->_done = 1;
+}
+
+void wws_spi_on_exchange(wws_spi_t *spi, wws_ret_t ret)
+{
+  wws_spi_stream_t *const stream = spi->_stream;
+  if (!stream) {
+    queue_on_exchange(spi, ret);
+    return;
+  }
+
+  stream->_len[stream->_send] = 0;
+  stream->_send ^= 1;
+  if (ret != WWS_RET_OK) {
+    /** pending buffers dropped */
+    stream->_ret    = ret;
+    stream->_ended  = 1;
+    stream->_len[0] = stream->_len[1] = 0;
+  }
+
+  /** next buffer ready, bus kept busy */
+  if (stream->_len[stream->_send]) {
+    stream_send(stream);
+    return;
+  }
+  if (!stream->_ended) {
+    stream->underruns++;
+    wws_event(WWS_COMP_SPI, WWS_EVT_UNDERRUN, stream->dev, stream);
+  }
+  stream->_busy = 0;
+}
+
+static void stream_release(wws_spi_stream_t *stream)
+{
+  dev_release(stream->dev);
+  stream->dev->spi->_stream = 0;
+  stream->_running          = 0;
+}
+
+/**
+ * @brief fill next buffer by producer
+ * @return false if ended
+ */
+static bool stream_fill(wws_spi_stream_t *stream)
+{
+  const unsigned int   i   = stream->_fill;
+  const unsigned short len = stream->fill(stream, stream->bufs[i], stream->size);
+
+  if (len == 0) {
+    stream->_ended = 1;
+    return false;
+  }
+  stream->_len[i] = len > stream->size ? stream->size : len;
+  stream->_fill ^= 1;
+  return true;
+}
+
+wws_ret_t wws_spi_stream_start(wws_spi_stream_t *stream)
+{
+  wws_assert(stream && stream->dev && stream->dev->spi && stream->bufs[0] && stream->bufs[1]);
+  wws_assert(stream->fill && stream->size);
+
+  wws_spi_dev_t *const dev = stream->dev;
+  wws_ret_t            ret = WWS_RET_OK;
+
+  if (dev->spi->_stream || wws_spi_is_busy(dev->spi)) return WWS_RET_ERR_BUSY;
+  if ((ret = dev_select(dev)) != WWS_RET_OK) {
+    dev_release(dev);
+    return ret;
+  }
+
+  stream->_len[0] = stream->_len[1] = 0;
+  stream->_fill = stream->_send = 0;
+  stream->_busy = stream->_ended = 0;
+  stream->_ret                   = WWS_RET_OK;
+  stream->_running               = 1;
+  dev->spi->_stream              = stream;
+
+  /** both buffers prefilled, so first exchange is not an underrun */
+  if (dev->spi->interface->exchange_async && stream_fill(stream)) stream_fill(stream);
+  wws_spi_stream_step(stream);
+  return WWS_RET_OK;
+}
+
+void wws_spi_stream_step(wws_spi_stream_t *stream)
+{
+  wws_assert(stream && stream->dev);
+  wws_spi_dev_t *const dev = stream->dev;
+
+  if (!stream->_running) return;
+
+  if (!dev->spi->interface->exchange_async) {
+    /** no async exchange, a buffer per routine sent in place */
+    if (!stream->_ended && stream_fill(stream)) {
+      const unsigned int i = stream->_send;
+      wws_ret_t          ret;
+
+      stream->_xfer =
+        (wws_spi_xfer_t){ .data = stream->bufs[i], .len = stream->_len[i], .buf = stream->rx[i] };
+      wws_event(WWS_COMP_SPI, WWS_EVT_XFER, dev, &stream->_xfer);
+      ret = dev->spi->interface->exchange(dev->spi->inst, &dev->cfg, &stream->_xfer);
+
+      stream->_len[i] = 0;
+      stream->_send ^= 1;
+      if (ret != WWS_RET_OK) {
+        stream->_ret   = ret;
+        stream->_ended = 1;
+      }
+    }
+  }
+  else {
+    /** fill buffers freed by exchange, in order */
+    while (!stream->_ended && !stream->_len[stream->_fill] && stream_fill(stream)) {}
+
+    /** bus idle (underrun), no exchange in flight can race */
+    if (!stream->_busy && stream->_len[stream->_send]) stream_send(stream);
+  }
+
+  /** released after filled buffers drained */
+  if (stream->_ended && !stream->_busy && !stream->_len[stream->_send]) stream_release(stream);
+}
+
+wws_ret_t wws_spi_stream_stop(wws_spi_stream_t *stream)
+{
+  wws_assert(stream);
+
+  if (!stream->_running) return stream->_ret;
+  stream->_ended  = 1;
+  stream->_len[0] = stream->_len[1] = 0;
+
+  /** exchange lost by platform is abandoned rather than hanging caller */
+  for (const unsigned int ts = wws_tick_get(); stream->_busy;) {
+    if (wws_tick_isup(ts, STOP_TIMEOUT)) {
+      stream->_busy = 0;
+      stream->_ret  = WWS_RET_ERR_TIMEOUT;
+      break;
+    }
+  }
+  stream_release(stream);
+  return stream->_ret;
+}
+
+wws_ret_t wws_spi_submit(wws_spi_dev_t *dev, wws_spi_xfer_t xfers[], wws_spi_callback_t callback)
+{
+  wws_assert(dev && dev->spi && dev->spi->interface && dev->spi->queue && xfers);
+  wws_spi_queue_t *const q = dev->spi->queue;
+  wws_assert(q->reqs && q->num && (q->num <= 0x7FFF));
+
+  if (wws_ring_count(q->_head, q->_tail, q->num) >= q->num) return WWS_RET_ERR_BUSY;
+
+  q->reqs[wws_ring_index(q->_tail, q->num)] =
+    (wws_spi_req_t){ .dev = dev, .xfers = xfers, .callback = callback };
+  q->_tail = wws_ring_next(q->_tail, q->num);
+
+  /** idle bus started at once, otherwise by service */
+  if (dev->spi->interface->exchange_async && !q->_active) wws_spi_step(dev->spi);
+  return WWS_RET_OK;
+}
+
+/**
+ * @brief select device of head request and begin its first xfer
+ */
+static void queue_begin(wws_spi_t *spi)
+{
+  wws_spi_queue_t *const     q   = spi->queue;
+  const wws_spi_req_t *const req = &q->reqs[wws_ring_index(q->_head, q->num)];
+  wws_ret_t                  ret = WWS_RET_OK;
+
+  q->_xfer   = 0;
+  q->_done   = 0;
+  q->_active = 1;
+
+  if (((ret = dev_select(req->dev)) == WWS_RET_OK) && req->xfers[0].len) {
+    wws_event(WWS_COMP_SPI, WWS_EVT_XFER, req->dev, &req->xfers[0]);
+    ret = spi->interface->exchange_async(spi->inst, &req->dev->cfg, &req->xfers[0]);
+    if (ret == WWS_RET_OK) return;
+  }
+  q->_ret  = ret;
+  q->_done = 1;
+}
+
+/**
+ * @brief release device, pop request, then callback, so callback can submit again
+ */
+static void queue_finish(wws_spi_t *spi, wws_ret_t ret)
+{
+  wws_spi_queue_t *const q   = spi->queue;
+  const wws_spi_req_t    req = q->reqs[wws_ring_index(q->_head, q->num)];
+
+  q->_head   = wws_ring_next(q->_head, q->num);
+  q->_active = 0;
+  q->_done   = 0;
+  if (req.callback) req.callback(ret, req.dev, &req);
+}
+
+void wws_spi_step(wws_spi_t *spi)
+{
+  wws_assert(spi && spi->interface);
+  wws_spi_queue_t *const q = spi->queue;
+  if (!q) return;
+
+  if (q->_active) {
+    if (!q->_done) return;
+    dev_release(q->reqs[wws_ring_index(q->_head, q->num)].dev);
+    queue_finish(spi, q->_ret);
+  }
+
+  /** bus owned by stream, queue waits */
+  if ((q->_head == q->_tail) || q->_active || spi->_stream) return;
+
+  if (spi->interface->exchange_async) {
+    queue_begin(spi);
+  }
+  else {
+    /** no async exchange, a transaction per routine in place */
+    const wws_spi_req_t *req = &q->reqs[wws_ring_index(q->_head, q->num)];
+    q->_active               = 1;
+    queue_finish(spi, xfer_run(req->dev, req->xfers));
+  }
+}
+
+void ___wws_spi_service_callback(wws_phase_t on, wws_service_t *serv)
+{
+  if (on == WWS_ON_ROUTINE) wws_spi_step(serv->inst);
+}
+
+void ___wws_spi_stream_service_callback(wws_phase_t on, wws_service_t *serv)
+{
+  if (on == WWS_ON_ROUTINE) wws_spi_stream_step(serv->inst);
+}
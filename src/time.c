@@ -5,6 +5,7 @@
  * Licensed under the MIT license. See LICENSE file in the project root for details.
  */
 #include <wws_mcu/time.h>
+#include <wws_mcu/compiler.h>
 
 volatile unsigned int wws_tick = 0;
 
@@ -18,6 +19,26 @@ void wws_delay(unsigned int ticks)
     ;
 }
 
+/** cpu clock in hz of delay loop, no default as a wrong clock shortens delays */
+#ifdef WWS_CONFIG_CPU_HZ
+WWS_WEAK void wws_delay_us(unsigned int us)
+{
+  /**
+   * long delays by ticks, loop count would overflow, one tick more as first tick edge may come
+   * at once, rest by loop
+   */
+  if (us >= 1000) {
+    wws_delay(WWS_MS(us / 1000) + 1);
+    us %= 1000;
+  }
+  for (volatile unsigned int n =
+         (us * (WWS_CONFIG_CPU_HZ / 1000U) + 1000U * WWS_CONFIG_DELAY_LOOP_CYCLES - 1U) /
+         (1000U * WWS_CONFIG_DELAY_LOOP_CYCLES);
+       n;
+       n--) {}
+}
+#endif /** WWS_CONFIG_CPU_HZ */
+
 void ___wws_tick_inc()
 {
   wws_tick++;
@@ -0,0 +1,14 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#include <wws_mcu/typedef.h>
+#include <wws_mcu/compiler.h>
+
+WWS_WEAK wws_evt_t WWS_EVT_WRITE = "WRITE";
+WWS_WEAK wws_evt_t WWS_EVT_READ  = "READ";
+
+extern wws_xfer_t WWS_XFER_WRITE WWS_ALIAS(WWS_EVT_WRITE);
+extern wws_xfer_t WWS_XFER_READ  WWS_ALIAS(WWS_EVT_READ);
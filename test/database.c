@@ -0,0 +1,301 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#include <wws.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define STORAGE_SIZE (1024U)
+#define DATA_SIZE    (300U)
+#define PAGE_SIZE    (16U)
+#define DEFAULT      (0x5A)
+
+/**
+ * @brief database of image over simulated memory region of @p _size
+ * @param ... override wws_database_t field
+ */
+#define DATABASE(_size, ...)                                                                       \
+  (wws_database_t)                                                                                 \
+  {                                                                                                \
+    .key = 0x1234, .head = &image.head, .tail = &image.tail,                                       \
+    .memory = { .interface = (wws_memory_inf_t *) &wws_memory_sim_interface,                      \
+                .inst      = &sim,                                                                 \
+                .size      = (_size) },                                                            \
+    ##__VA_ARGS__                                                                                  \
+  }
+
+static struct
+{
+  unsigned int head;
+  char         data[DATA_SIZE];
+  unsigned int tail;
+} image;
+
+static char         storage[STORAGE_SIZE];
+static unsigned int wear[WWS_MEMORY_SIM_PAGES(STORAGE_SIZE, PAGE_SIZE)];
+
+static wws_memory_sim_t sim = {
+  .data = storage, .size = STORAGE_SIZE, .page_size = PAGE_SIZE, .wear = wear
+};
+
+static void defaults(void)
+{
+  memset(&image, 0, sizeof(image));
+  memset(image.data, DEFAULT, DATA_SIZE);
+}
+
+static bool is_default(void)
+{
+  for (unsigned int i = 0; i < DATA_SIZE; i++) {
+    if (image.data[i] != DEFAULT) return false;
+  }
+  return true;
+}
+
+/**
+ * @brief flipped data byte fails crc, re-init keeps defaults rather than corrupted data
+ */
+static void test_crc_corrupt(void)
+{
+  wws_database_t db = DATABASE(STORAGE_SIZE, .crc = 1);
+
+  memset(storage, 0xFF, STORAGE_SIZE);
+  defaults();
+  assert(wws_database_load(&db) == WWS_RET_REINIT);
+  assert(is_default());
+
+  image.data[10] = 1;
+  assert(wws_database_save(&db) == WWS_RET_OK);
+  defaults();
+  assert(wws_database_load(&db) == WWS_RET_OK);
+  assert(image.data[10] == 1);
+
+  defaults();
+  storage[4 + 20] ^= 0x01;
+  assert(wws_database_load(&db) == WWS_RET_REINIT);
+  assert(is_default());
+
+  /** re-init persisted defaults with valid crc */
+  memset(image.data, 0, DATA_SIZE);
+  assert(wws_database_load(&db) == WWS_RET_OK);
+  assert(is_default());
+}
+
+/**
+ * @brief crc-only image fits a region of data plus keys and crc, second mount finds it
+ */
+static void test_crc_exact_region(void)
+{
+  wws_database_t db = DATABASE(DATA_SIZE + 12, .crc = 1);
+
+  memset(storage, 0xFF, STORAGE_SIZE);
+  defaults();
+  assert(wws_database_load(&db) == WWS_RET_REINIT);
+  image.data[10] = 1;
+  assert(wws_database_save(&db) == WWS_RET_OK);
+
+  defaults();
+  assert(wws_database_load(&db) == WWS_RET_OK);
+  assert(image.data[10] == 1);
+}
+
+/**
+ * @brief plain image of version 0 still fits a region of data plus keys
+ */
+static void test_plain_exact_region(void)
+{
+  wws_database_t db = DATABASE(DATA_SIZE + 8);
+
+  memset(storage, 0xFF, STORAGE_SIZE);
+  defaults();
+  assert(wws_database_load(&db) == WWS_RET_REINIT);
+  image.data[10] = 1;
+  assert(wws_database_save(&db) == WWS_RET_OK);
+
+  defaults();
+  assert(wws_database_load(&db) == WWS_RET_OK);
+  assert(image.data[10] == 1);
+}
+
+/**
+ * @brief both slots corrupted in A/B mode, re-init keeps defaults rather than last slot tried
+ */
+static void test_ab_corrupt(void)
+{
+  wws_database_t db = DATABASE(STORAGE_SIZE, .ab = 1);
+
+  memset(storage, 0xFF, STORAGE_SIZE);
+  defaults();
+  assert(wws_database_load(&db) == WWS_RET_REINIT);
+  assert(is_default());
+
+  /** an image in each slot */
+  image.data[10] = 1;
+  assert(wws_database_save(&db) == WWS_RET_OK);
+  image.data[10] = 2;
+  assert(wws_database_save(&db) == WWS_RET_OK);
+  defaults();
+  assert(wws_database_load(&db) == WWS_RET_OK);
+  assert(image.data[10] == 2);
+
+  defaults();
+  storage[4 + 20] ^= 0x01;
+  storage[(STORAGE_SIZE / 2) + 4 + 20] ^= 0x01;
+  assert(wws_database_load(&db) == WWS_RET_REINIT);
+  assert(is_default());
+  assert((db._slot == 0) && (db._seq == 1));
+
+  memset(image.data, 0, DATA_SIZE);
+  assert(wws_database_load(&db) == WWS_RET_OK);
+  assert(is_default());
+}
+
+static wws_ret_t migrate_fail(wws_database_t *db, wws_memory_t *old)
+{
+  memset(image.data, 0x77, DATA_SIZE / 2);
+  return WWS_RET_ERR_OTHER;
+}
+
+/**
+ * @brief failed migration re-inits from defaults rather than half migrated data
+ */
+static void test_migrate_fail(void)
+{
+  static char    initial[DATA_SIZE];
+  wws_database_t v1 = DATABASE(STORAGE_SIZE, .crc = 1, .version = 1);
+  wws_database_t v2 = DATABASE(STORAGE_SIZE,
+                               .crc        = 1,
+                               .version    = 2,
+                               .migrations = (const wws_database_migration_t[]){
+                                 { .version = 1, .size = DATA_SIZE, .migrate = migrate_fail },
+                                 { .size = 0 },
+                               },
+                               .defaults   = initial);
+
+  memset(storage, 0xFF, STORAGE_SIZE);
+  memset(initial, DEFAULT, DATA_SIZE);
+  defaults();
+  assert(wws_database_load(&v1) == WWS_RET_REINIT);
+  image.data[10] = 1;
+  assert(wws_database_save(&v1) == WWS_RET_OK);
+
+  assert(wws_database_load(&v2) == WWS_RET_REINIT);
+  assert(is_default());
+
+  memset(image.data, 0, DATA_SIZE);
+  assert(wws_database_load(&v2) == WWS_RET_OK);
+  assert(is_default());
+}
+
+/**
+ * @brief save writes only the page of changed byte and crc trailer, nothing without change
+ */
+static void test_changed_pages(void)
+{
+  static unsigned int hashes[(DATA_SIZE + 8) / PAGE_SIZE + 1];
+  wws_database_t      db =
+    DATABASE(STORAGE_SIZE, .crc = 1, .page_size = PAGE_SIZE, .hashes = hashes);
+  wws_database_t      again =
+    DATABASE(STORAGE_SIZE, .crc = 1, .page_size = PAGE_SIZE, .hashes = hashes);
+
+  memset(storage, 0xFF, STORAGE_SIZE);
+  defaults();
+  assert(wws_database_load(&db) == WWS_RET_REINIT);
+
+  /** remount syncs hashes with memory */
+  assert(wws_database_load(&again) == WWS_RET_OK);
+  memset(wear, 0, sizeof(wear));
+  sim.written = 0;
+
+  /** data byte 100 at 4 + 100 in page 6, crc after tail key at 8 + DATA_SIZE in page 19 */
+  image.data[100] = 1;
+  assert(wws_database_save(&again) == WWS_RET_OK);
+  assert(sim.written == PAGE_SIZE + 4);
+  for (unsigned int p = 0; p < (sizeof(wear) / sizeof(wear[0])); p++) {
+    assert(wear[p] == (((p == 6) || (p == 19)) ? 1 : 0));
+  }
+
+  assert(wws_database_save(&again) == WWS_RET_OK);
+  assert(sim.written == PAGE_SIZE + 4);
+
+  defaults();
+  assert(wws_database_load(&again) == WWS_RET_OK);
+  assert(image.data[100] == 1);
+}
+
+static unsigned int done;
+
+static void on_debug(const wws_debug_t *debug)
+{
+  if ((debug->component != WWS_COMP_DATABASE) || (debug->event != WWS_EVT_DONE)) return;
+  assert(debug->data[1] == WWS_RET_OK);
+  done++;
+}
+
+/**
+ * @brief requests coalesce into one background save of a page per routine, done reported
+ */
+static void test_background_save(void)
+{
+  static unsigned int hashes[(DATA_SIZE + 8) / PAGE_SIZE + 1];
+  wws_database_t      db =
+    DATABASE(STORAGE_SIZE, .crc = 1, .page_size = PAGE_SIZE, .hashes = hashes);
+  wws_service_t       serv = { WWS_DATABASE_SAVE_SERVICE, .inst = &db };
+
+  memset(storage, 0xFF, STORAGE_SIZE);
+  defaults();
+  assert(wws_database_load(&db) == WWS_RET_REINIT);
+  wws_debug_set_callback(on_debug);
+  done        = 0;
+  sim.written = 0;
+
+  /** pages 0 and 12 changed, data of page 0 starts after head key */
+  image.data[10]  = 1;
+  image.data[200] = 2;
+  wws_database_save_request(&db);
+  wws_database_save_request(&db);
+  assert(wws_database_is_saving(&db) && (sim.written == 0));
+
+  ___wws_database_save_service_callback(WWS_ON_ROUTINE, &serv);
+  assert(wws_database_is_saving(&db) && (sim.written == PAGE_SIZE - 4));
+  /** request while saving runs one more save after this one */
+  image.data[10] = 3;
+  wws_database_save_request(&db);
+  wws_database_save_request(&db);
+
+  for (unsigned int r = 0; wws_database_is_saving(&db); r++) {
+    assert(r < 100);
+    ___wws_database_save_service_callback(WWS_ON_ROUTINE, &serv);
+  }
+  assert(done == 2);
+  /** page 0 and crc saved twice, page 12 once */
+  assert(sim.written == 2 * (PAGE_SIZE - 4) + PAGE_SIZE + 2 * 4);
+
+  /** idle without request */
+  ___wws_database_save_service_callback(WWS_ON_ROUTINE, &serv);
+  assert((done == 2) && (sim.written == 2 * (PAGE_SIZE - 4) + PAGE_SIZE + 2 * 4));
+  wws_debug_set_callback(0);
+
+  defaults();
+  assert(wws_database_load(&db) == WWS_RET_OK);
+  assert((image.data[10] == 3) && (image.data[200] == 2));
+}
+
+int main(int argc, char const *argv[])
+{
+  test_crc_corrupt();
+  test_crc_exact_region();
+  test_plain_exact_region();
+  test_ab_corrupt();
+  test_migrate_fail();
+  test_changed_pages();
+  test_background_save();
+
+  puts("database: ok");
+  return 0;
+}
@@ -0,0 +1,257 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#include <wws.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CELLS (16U * 1024U)
+#define ADDR  (0x50)
+
+static unsigned char cells[CELLS];
+
+static wws_eeprom_sim_t sim = { .schema = &wws_eeprom_AT24C128, .data = cells, .tick = 1 };
+static wws_i2c_t        bus = { .interface = (wws_i2c_inf_t *) &wws_eeprom_sim_interface,
+                                .inst      = &sim };
+
+/**
+ * @brief let write cycle of model end
+ */
+static void settle(void)
+{
+  if (sim.elapsed < sim._busy_until) sim.elapsed = sim._busy_until;
+}
+
+/**
+ * @brief address and data as two write xfers form one page write, data not taken as address
+ */
+static void test_write_continues(void)
+{
+  const unsigned char addr[] = { 0x01, 0x00 };
+  const unsigned char data[] = { 0xA1, 0xA2, 0xA3 };
+  const unsigned int  cycles = sim.cycles;
+
+  memset(cells, 0xFF, CELLS);
+  assert(wws_i2c_xfer(&bus,
+                      ADDR,
+                      (wws_i2c_xfer_t[]){ { .cptr = addr, .size = 2, .xfer = WWS_XFER_WRITE },
+                                          { .cptr = data, .size = 3, .xfer = WWS_XFER_WRITE },
+                                          {} },
+                      WWS_MS(10)) == WWS_RET_OK);
+  assert(sim.cycles == cycles + 1);
+  assert(memcmp(&cells[0x100], data, sizeof(data)) == 0);
+  assert(cells[0xA1A2 % CELLS] == 0xFF);
+  settle();
+}
+
+/**
+ * @brief write followed by read still starts again, address pointer set by write kept
+ */
+static void test_read_restarts(void)
+{
+  const unsigned char addr[] = { 0x01, 0x00 };
+  unsigned char       buf[3] = { 0 };
+  const unsigned int  cycles = sim.cycles;
+
+  memcpy(&cells[0x100], (unsigned char[]){ 1, 2, 3 }, 3);
+  assert(wws_i2c_xfer(&bus,
+                      ADDR,
+                      (wws_i2c_xfer_t[]){ { .cptr = addr, .size = 2, .xfer = WWS_XFER_WRITE },
+                                          { .ptr = buf, .size = 3, .xfer = WWS_XFER_READ },
+                                          {} },
+                      WWS_MS(10)) == WWS_RET_OK);
+  assert((buf[0] == 1) && (buf[1] == 2) && (buf[2] == 3));
+  assert(sim.cycles == cycles);
+}
+
+/**
+ * @brief driver write across pages reads back through model
+ */
+static void test_eeprom_roundtrip(void)
+{
+  static unsigned char data[200], buf[200];
+  wws_eeprom_t         eeprom  = { .schema = &wws_eeprom_AT24C128, .bus = &bus };
+  unsigned int         written = 0;
+
+  for (unsigned int i = 0; i < sizeof(data); i++) data[i] = (unsigned char) (i * 7 + 1);
+  memset(cells, 0xFF, CELLS);
+  assert(wws_eeprom_write(&eeprom, 50, data, sizeof(data), &written) == WWS_RET_OK);
+  assert(written == sizeof(data));
+  settle();
+  assert(wws_eeprom_read(&eeprom, 50, sizeof(buf), buf) == WWS_RET_OK);
+  assert(memcmp(buf, data, sizeof(data)) == 0);
+  assert(memcmp(&cells[50], data, sizeof(data)) == 0);
+}
+
+/**
+ * @brief read is rejected while async write runs, rather than stalling through tWR
+ */
+static void test_read_during_async(void)
+{
+  static unsigned char data[100], buf[100];
+  wws_eeprom_t         eeprom = { .schema = &wws_eeprom_AT24C128, .bus = &bus };
+
+  for (unsigned int i = 0; i < sizeof(data); i++) data[i] = (unsigned char) (i + 3);
+  memset(cells, 0xFF, CELLS);
+  assert(wws_eeprom_write_async(&eeprom, 0, data, sizeof(data), 0) == WWS_RET_OK);
+  assert(wws_eeprom_read(&eeprom, 0, sizeof(buf), buf) == WWS_RET_ERR_BUSY);
+
+  while (wws_eeprom_step(&eeprom)) {
+    ___wws_tick_inc();
+    settle();
+  }
+  assert(wws_eeprom_read(&eeprom, 0, sizeof(buf), buf) == WWS_RET_OK);
+  assert(memcmp(buf, data, sizeof(data)) == 0);
+}
+
+/** async operation begun on bus of mock, completed by complete() */
+static enum { IDLE, START, BYTE, STOP } pending;
+static unsigned int starts;
+
+static wws_ret_t mock_ready(void *inst)
+{
+  return WWS_RET_OK;
+}
+
+static wws_ret_t mock_start(void *inst, unsigned short addr, wws_xfer_t xfer, unsigned int timeout)
+{
+  starts++;
+  return WWS_RET_OK;
+}
+
+static void mock_stop(void *inst, unsigned short addr, unsigned int timeout) {}
+
+static wws_ret_t mock_put(void *inst, unsigned char byte, unsigned int timeout)
+{
+  return WWS_RET_OK;
+}
+
+static void mock_start_async(void *inst, unsigned short addr, wws_xfer_t xfer, bool restart)
+{
+  pending = START;
+}
+
+static void mock_put_async(void *inst, unsigned char byte)
+{
+  pending = BYTE;
+}
+
+static void mock_get_async(void *inst, bool last)
+{
+  pending = BYTE;
+}
+
+static void mock_stop_async(void *inst)
+{
+  pending = STOP;
+}
+
+static const wws_i2c_inf_t mock_interface = {
+  .is_ready    = mock_ready,
+  .start       = mock_start,
+  .stop        = mock_stop,
+  .put         = mock_put,
+  .start_async = mock_start_async,
+  .put_async   = mock_put_async,
+  .get_async   = mock_get_async,
+  .stop_async  = mock_stop_async,
+};
+
+/**
+ * @brief run interrupts of mock until engine idles
+ */
+static void complete(wws_i2c_t *i2c)
+{
+  while (pending != IDLE) {
+    const int op = pending;
+    pending      = IDLE;
+    if (op == START) wws_i2c_on_start(i2c, WWS_RET_OK);
+    else if (op == BYTE)
+      wws_i2c_on_byte(i2c, WWS_RET_OK, 0);
+    else
+      wws_i2c_on_stop(i2c);
+  }
+}
+
+/**
+ * @brief blocking transfers are rejected while async transaction owns the bus
+ */
+static void test_sync_during_async(void)
+{
+  static wws_i2c_req_t   reqs[2];
+  static wws_i2c_queue_t queue   = { .reqs = reqs, .num = 2 };
+  wws_i2c_t              mock    = { .interface = (wws_i2c_inf_t *) &mock_interface,
+                                     .queue     = &queue };
+  const unsigned char    byte    = 0x5A;
+  wws_i2c_xfer_t         xfers[] = { { .cptr = &byte, .size = 1, .xfer = WWS_XFER_WRITE }, {} };
+
+  starts = 0;
+  assert(wws_i2c_submit(&mock, ADDR, xfers, 0) == WWS_RET_OK);
+  assert(pending == START);
+  assert(wws_i2c_xfer(&mock, ADDR, xfers, WWS_MS(10)) == WWS_RET_ERR_BUSY);
+  assert(wws_i2c_test_device(&mock, ADDR, WWS_MS(10)) == WWS_RET_ERR_BUSY);
+  assert(starts == 0);
+
+  complete(&mock);
+  assert(!queue._active);
+  assert(wws_i2c_xfer(&mock, ADDR, xfers, WWS_MS(10)) == WWS_RET_OK);
+  assert(wws_i2c_test_device(&mock, ADDR, WWS_MS(10)) == WWS_RET_OK);
+  assert(starts == 2);
+}
+
+static unsigned int done;
+
+static void on_done(wws_ret_t ret, wws_i2c_t *i2c, const wws_i2c_req_t *req)
+{
+  assert(ret == WWS_RET_OK);
+  done++;
+}
+
+/**
+ * @brief bus request not taken by full engine queue stays queued and is dispatched by step
+ */
+static void test_bus_engine_full(void)
+{
+  static wws_i2c_req_t   reqs[1], dev_reqs[2];
+  static wws_i2c_queue_t queue   = { .reqs = reqs, .num = 1 };
+  static wws_i2c_t       mock    = { .interface = (wws_i2c_inf_t *) &mock_interface,
+                                     .queue     = &queue };
+  static wws_i2c_dev_t   dev     = { .addr = ADDR, .reqs = dev_reqs, .num = 2 };
+  wws_i2c_bus_t          bus     = { .i2c = &mock, .devs = (wws_i2c_dev_t *[]){ &dev, 0 } };
+  const unsigned char    byte    = 0x5A;
+  wws_i2c_xfer_t         xfers[] = { { .cptr = &byte, .size = 1, .xfer = WWS_XFER_WRITE }, {} };
+
+  done = 0;
+  assert(wws_i2c_submit(&mock, ADDR, xfers, on_done) == WWS_RET_OK);
+  assert(wws_i2c_bus_submit(&bus, &dev, xfers, on_done) == WWS_RET_OK);
+  assert(!wws_i2c_bus_is_busy(&bus));
+
+  /** still pending while engine busy */
+  wws_i2c_bus_step(&bus);
+  assert(!wws_i2c_bus_is_busy(&bus));
+  complete(&mock);
+  assert(done == 1);
+
+  wws_i2c_bus_step(&bus);
+  assert(wws_i2c_bus_is_busy(&bus));
+  complete(&mock);
+  assert((done == 2) && !wws_i2c_bus_is_busy(&bus));
+}
+
+int main(int argc, char const *argv[])
+{
+  test_write_continues();
+  test_read_restarts();
+  test_eeprom_roundtrip();
+  test_read_during_async();
+  test_sync_during_async();
+  test_bus_engine_full();
+
+  puts("i2c: ok");
+  return 0;
+}
@@ -0,0 +1,155 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#include <wws.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define STORAGE_SIZE (256U)
+#define IDS          (4U)
+#define RECORD       (4U + 4U + 4U) /** head, unsigned int, crc */
+
+static char             storage[STORAGE_SIZE];
+static unsigned int     index_[IDS];
+static wws_memory_sim_t sim = { .data = storage, .size = STORAGE_SIZE };
+
+/**
+ * @brief journal over simulated memory, mounted as after reboot
+ */
+static wws_journal_t fixture(void)
+{
+  return (wws_journal_t){ .memory = { .interface = (wws_memory_inf_t *) &wws_memory_sim_interface,
+                                      .inst      = &sim,
+                                      .size      = STORAGE_SIZE },
+                          .index  = index_,
+                          .ids    = IDS };
+}
+
+static void erase(void)
+{
+  memset(storage, 0xFF, STORAGE_SIZE);
+  sim.fail = 0;
+}
+
+static unsigned int get_int(wws_journal_t *j, unsigned short id)
+{
+  unsigned int value = 0, len = 0;
+  assert(wws_journal_read(j, id, &value, sizeof(value), &len) == WWS_RET_OK);
+  assert(len == sizeof(value));
+  return value;
+}
+
+static void set_int(wws_journal_t *j, unsigned short id, unsigned int value)
+{
+  assert(wws_journal_write(j, id, &value, sizeof(value)) == WWS_RET_OK);
+}
+
+/**
+ * @brief record torn by power loss is dropped on mount, earlier record of id wins
+ */
+static void test_torn_record(void)
+{
+  wws_journal_t j     = fixture();
+  unsigned int  value = 3;
+
+  erase();
+  assert(wws_journal_mount(&j) == WWS_RET_REINIT);
+  set_int(&j, 0, 1);
+  set_int(&j, 1, 2);
+
+  /** power lost after head and part of data */
+  sim.fail       = 1;
+  sim.fail_after = sim.written + 6;
+  assert(wws_journal_write(&j, 0, &value, sizeof(value)) == WWS_RET_ERR_FAULT);
+  sim.fail = 0;
+
+  wws_journal_t again = fixture();
+  assert(wws_journal_mount(&again) == WWS_RET_OK);
+  assert(get_int(&again, 0) == 1);
+  assert(get_int(&again, 1) == 2);
+
+  /** torn record overwritten by next append */
+  set_int(&again, 0, 4);
+  wws_journal_t third = fixture();
+  assert(wws_journal_mount(&third) == WWS_RET_OK);
+  assert(get_int(&third, 0) == 4);
+  assert(get_int(&third, 1) == 2);
+}
+
+/**
+ * @brief full half compacts into the other, live records and deletes kept across remount
+ */
+static void test_compact(void)
+{
+  wws_journal_t j     = fixture();
+  unsigned int  value = 0;
+
+  erase();
+  wws_journal_mount(&j);
+  set_int(&j, 1, 100);
+  set_int(&j, 2, 200);
+  assert(wws_journal_write(&j, 2, 0, 0) == WWS_RET_OK);
+
+  for (value = 0; j._gen == 1; value++) set_int(&j, 0, value);
+  /** header, live records of id 0 and 1 copied, new record of id 0 appended */
+  assert((j._half == 1) && (j._end == (12 + 3 * RECORD)));
+
+  wws_journal_t again = fixture();
+  assert(wws_journal_mount(&again) == WWS_RET_OK);
+  assert((again._gen == 2) && (again._half == 1));
+  assert(get_int(&again, 0) == value - 1);
+  assert(get_int(&again, 1) == 100);
+  assert(wws_journal_read(&again, 2, &value, sizeof(value), 0) == WWS_RET_ERR_NO_DATA);
+}
+
+/**
+ * @brief power loss during compaction keeps old half active
+ */
+static void test_compact_torn(void)
+{
+  wws_journal_t j = fixture();
+
+  erase();
+  wws_journal_mount(&j);
+  set_int(&j, 1, 100);
+  for (unsigned int value = 0; (j._end + RECORD) <= (STORAGE_SIZE / 2); value++) {
+    set_int(&j, 0, value);
+  }
+  const unsigned int last = get_int(&j, 0);
+
+  /** records copied, header of new half not */
+  sim.fail       = 1;
+  sim.fail_after = sim.written + 2 * RECORD;
+  assert(wws_journal_write(&j, 0, &(unsigned int){ 0xAA }, 4) == WWS_RET_ERR_FAULT);
+  sim.fail = 0;
+  assert((j._gen == 1) && (j._half == 0));
+
+  wws_journal_t again = fixture();
+  assert(wws_journal_mount(&again) == WWS_RET_OK);
+  assert((again._gen == 1) && (again._half == 0));
+  assert(get_int(&again, 0) == last);
+  assert(get_int(&again, 1) == 100);
+
+  /** compaction retried by next write */
+  set_int(&again, 0, 0xAA);
+  assert(again._gen == 2);
+  wws_journal_t third = fixture();
+  assert(wws_journal_mount(&third) == WWS_RET_OK);
+  assert(get_int(&third, 0) == 0xAA);
+  assert(get_int(&third, 1) == 100);
+}
+
+int main(int argc, char const *argv[])
+{
+  test_torn_record();
+  test_compact();
+  test_compact_torn();
+
+  puts("journal: ok");
+  return 0;
+}
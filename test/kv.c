@@ -0,0 +1,168 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#include <wws.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define STORAGE_SIZE (2048U)
+#define IDS          (7U) /** not a power of two */
+
+/** integer keys of FNV-1a hash 0xFFFFFFFF and of the same home slot (3 of 7) */
+#define KEY_WRAP (0x3F50A855U)
+#define KEY_HOME (11U)
+
+static char             storage[STORAGE_SIZE];
+static unsigned int     index_[IDS];
+static unsigned int     hashes[IDS];
+static wws_memory_sim_t sim = { .data = storage, .size = STORAGE_SIZE };
+
+/**
+ * @brief store over simulated memory, mounted as after reboot
+ */
+static wws_kv_t fixture(void)
+{
+  return (wws_kv_t){
+    .journal = { .memory = { .interface = (wws_memory_inf_t *) &wws_memory_sim_interface,
+                             .inst      = &sim,
+                             .size      = STORAGE_SIZE },
+                 .index  = index_,
+                 .ids    = IDS },
+    .hashes  = hashes,
+  };
+}
+
+static void erase(void)
+{
+  memset(storage, 0xFF, STORAGE_SIZE);
+}
+
+static unsigned int get_int(wws_kv_t *kv, wws_kv_key_t key)
+{
+  unsigned int value = 0, len = 0;
+  assert(wws_kv_get(kv, key, &value, sizeof(value), &len) == WWS_RET_OK);
+  assert(len == sizeof(value));
+  return value;
+}
+
+static void set_int(wws_kv_t *kv, wws_kv_key_t key, unsigned int value)
+{
+  assert(wws_kv_set(kv, key, &value, sizeof(value)) == WWS_RET_OK);
+}
+
+/**
+ * @brief string and integer keys set, overwritten and found after remount
+ */
+static void test_set_get(void)
+{
+  wws_kv_t     kv      = fixture();
+  char         buf[16] = { 0 };
+  unsigned int len     = 0;
+  unsigned int value   = 0;
+
+  erase();
+  assert(wws_kv_mount(&kv) == WWS_RET_REINIT);
+  assert(wws_kv_get(&kv, WWS_KV_STR("volume"), &value, sizeof(value), 0) == WWS_RET_ERR_NO_DATA);
+
+  set_int(&kv, WWS_KV_STR("volume"), 42);
+  assert(wws_kv_set(&kv, WWS_KV_INT(7), "abc", 3) == WWS_RET_OK);
+  set_int(&kv, WWS_KV_STR("volume"), 43);
+
+  wws_kv_t again = fixture();
+  assert(wws_kv_mount(&again) == WWS_RET_OK);
+  assert(get_int(&again, WWS_KV_STR("volume")) == 43);
+  assert(wws_kv_get(&again, WWS_KV_INT(7), buf, sizeof(buf), &len) == WWS_RET_OK);
+  assert((len == 3) && (memcmp(buf, "abc", 3) == 0));
+  /** string and integer keys never match */
+  assert(wws_kv_get(&again, WWS_KV_STR("7"), buf, sizeof(buf), 0) == WWS_RET_ERR_NO_DATA);
+}
+
+/**
+ * @brief deleted keys stay deleted after remount, others kept
+ */
+static void test_delete(void)
+{
+  wws_kv_t     kv    = fixture();
+  unsigned int value = 0;
+
+  erase();
+  wws_kv_mount(&kv);
+  set_int(&kv, WWS_KV_STR("gain"), 1);
+  set_int(&kv, WWS_KV_INT(5), 2);
+
+  assert(wws_kv_delete(&kv, WWS_KV_STR("gain")) == WWS_RET_OK);
+  assert(wws_kv_delete(&kv, WWS_KV_STR("gain")) == WWS_RET_ERR_NO_DATA);
+  assert(wws_kv_get(&kv, WWS_KV_STR("gain"), &value, sizeof(value), 0) == WWS_RET_ERR_NO_DATA);
+
+  wws_kv_t again = fixture();
+  assert(wws_kv_mount(&again) == WWS_RET_OK);
+  assert(wws_kv_get(&again, WWS_KV_STR("gain"), &value, sizeof(value), 0) ==
+         WWS_RET_ERR_NO_DATA);
+  assert(get_int(&again, WWS_KV_INT(5)) == 2);
+}
+
+/**
+ * @brief full table rejects new key, deleted slot in middle of chain is reused
+ */
+static void test_full_and_tombstone(void)
+{
+  wws_kv_t     kv    = fixture();
+  unsigned int value = 0;
+
+  erase();
+  wws_kv_mount(&kv);
+  for (unsigned int k = 0; k < IDS; k++) set_int(&kv, WWS_KV_INT(100 + k), k);
+  assert(wws_kv_set(&kv, WWS_KV_INT(200), &value, sizeof(value)) == WWS_RET_ERR_OVERSIZE);
+  /** existing key still updated in place */
+  set_int(&kv, WWS_KV_INT(103), 33);
+
+  /** table is full, so no slot is empty and delete leaves a tombstone */
+  assert(wws_kv_delete(&kv, WWS_KV_INT(102)) == WWS_RET_OK);
+  set_int(&kv, WWS_KV_INT(200), 200);
+  assert(wws_kv_set(&kv, WWS_KV_INT(201), &value, sizeof(value)) == WWS_RET_ERR_OVERSIZE);
+
+  wws_kv_t again = fixture();
+  assert(wws_kv_mount(&again) == WWS_RET_OK);
+  for (unsigned int k = 0; k < IDS; k++) {
+    const unsigned int expect = (k == 3) ? 33 : k;
+    if (k == 2) continue;
+    assert(get_int(&again, WWS_KV_INT(100 + k)) == expect);
+  }
+  assert(get_int(&again, WWS_KV_INT(200)) == 200);
+}
+
+/**
+ * @brief probe past hash 0xFFFFFFFF continues at next slot, so deleting chain head keeps key
+ */
+static void test_probe_wrap(void)
+{
+  wws_kv_t kv = fixture();
+
+  erase();
+  wws_kv_mount(&kv);
+  set_int(&kv, WWS_KV_INT(KEY_HOME), 1);
+  set_int(&kv, WWS_KV_INT(KEY_WRAP), 2);
+
+  assert(wws_kv_delete(&kv, WWS_KV_INT(KEY_HOME)) == WWS_RET_OK);
+  assert(get_int(&kv, WWS_KV_INT(KEY_WRAP)) == 2);
+
+  wws_kv_t again = fixture();
+  assert(wws_kv_mount(&again) == WWS_RET_OK);
+  assert(get_int(&again, WWS_KV_INT(KEY_WRAP)) == 2);
+}
+
+int main(int argc, char const *argv[])
+{
+  test_set_get();
+  test_delete();
+  test_full_and_tombstone();
+  test_probe_wrap();
+
+  puts("kv: ok");
+  return 0;
+}
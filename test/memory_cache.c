@@ -0,0 +1,107 @@
+/**
+ * MCU Framework and library
+ *
+ * Copyright (c) Woody Wave Sound and contributors. All rights reserved.
+ * Licensed under the MIT license. See LICENSE file in the project root for details.
+ */
+#include <wws.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define STORAGE_SIZE (256U)
+#define PAGE_SIZE    (16U)
+#define LINES        (2U)
+
+static char                    storage[STORAGE_SIZE];
+static char                    buffer[PAGE_SIZE * LINES];
+static wws_memory_cache_line_t lines[LINES];
+static wws_memory_sim_t        sim = { .data = storage, .size = STORAGE_SIZE };
+static wws_memory_t backing = { .interface = (wws_memory_inf_t *) &wws_memory_sim_interface,
+                                .inst      = &sim,
+                                .size      = STORAGE_SIZE };
+
+/**
+ * @brief empty cache over erased memory, write counter of memory cleared
+ */
+static wws_memory_cache_t fixture(void)
+{
+  memset(storage, 0xFF, STORAGE_SIZE);
+  memset(lines, 0, sizeof(lines));
+  sim.written = 0;
+  return (wws_memory_cache_t){
+    .memory = &backing, .buffer = buffer, .lines = lines, .page_size = PAGE_SIZE, .num = LINES
+  };
+}
+
+/**
+ * @brief memory of cache as drop-in for backing memory
+ */
+static wws_memory_t over(wws_memory_cache_t *cache)
+{
+  return (wws_memory_t){ .interface = (wws_memory_inf_t *) &wws_memory_cache_interface,
+                         .inst      = cache,
+                         .size      = STORAGE_SIZE };
+}
+
+/**
+ * @brief writes stay in cache, evicted dirty page is written back as whole page
+ */
+static void test_evict_dirty(void)
+{
+  wws_memory_cache_t cache  = fixture();
+  wws_memory_t       memory = over(&cache);
+  char               buf[4] = { 0 };
+
+  assert(wws_memory_write8(&memory, 0, "abcd", 4, 0) == WWS_RET_OK);
+  assert(wws_memory_write8(&memory, PAGE_SIZE + 2, "efgh", 4, 0) == WWS_RET_OK);
+  assert(sim.written == 0);
+
+  /** page 0 least recently used, miss of page 2 writes it back */
+  assert(wws_memory_read8(&memory, 2 * PAGE_SIZE, 4, buf, 0) == WWS_RET_OK);
+  assert(sim.written == PAGE_SIZE);
+  assert(memcmp(storage, "abcd", 4) == 0);
+  assert(storage[PAGE_SIZE + 2] == (char) 0xFF);
+
+  /** written back page read again from memory */
+  assert(wws_memory_read8(&memory, 0, 4, buf, 0) == WWS_RET_OK);
+  assert(memcmp(buf, "abcd", 4) == 0);
+
+  assert(wws_memory_cache_flush(&cache) == WWS_RET_OK);
+  assert(sim.written == 2 * PAGE_SIZE);
+  assert(memcmp(&storage[PAGE_SIZE + 2], "efgh", 4) == 0);
+  /** rest of partly written page fetched before, kept */
+  assert(storage[PAGE_SIZE] == (char) 0xFF);
+}
+
+/**
+ * @brief clean pages are dropped on eviction, flush of clean cache writes nothing
+ */
+static void test_evict_clean(void)
+{
+  wws_memory_cache_t cache  = fixture();
+  wws_memory_t       memory = over(&cache);
+  char               buf[4] = { 0 };
+
+  for (unsigned int page = 0; page < (STORAGE_SIZE / PAGE_SIZE); page++) {
+    assert(wws_memory_read8(&memory, page * PAGE_SIZE, 4, buf, 0) == WWS_RET_OK);
+  }
+  assert(wws_memory_cache_flush(&cache) == WWS_RET_OK);
+  assert(sim.written == 0);
+
+  /** flushed line is clean, second flush writes nothing */
+  assert(wws_memory_write8(&memory, 0, "abcd", 4, 0) == WWS_RET_OK);
+  assert(wws_memory_cache_flush(&cache) == WWS_RET_OK);
+  assert(wws_memory_cache_flush(&cache) == WWS_RET_OK);
+  assert(sim.written == PAGE_SIZE);
+}
+
+int main(int argc, char const *argv[])
+{
+  test_evict_dirty();
+  test_evict_clean();
+
+  puts("memory_cache: ok");
+  return 0;
+}
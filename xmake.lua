@@ -18,28 +18,38 @@ target("mcu")
     
     add_files("src/time.c")
     add_files("src/debug.c")
+    add_files("src/xfer.c")
 
     add_files("src/byte.c")
     add_files("src/data.c")
+    add_files("src/crc.c")
     add_files("src/countdown.c")
     add_files("src/memory.c")
+    add_files("src/memory_cache.c")
+    add_files("src/memory_sim.c")
     add_files("src/manifest.c")
 
     add_files("src/service.c")
     add_files("src/tick.c")
 
     add_files("src/i2c.c")
+    add_files("src/i2c_bus.c")
+    add_files("src/i2c_soft.c")
     add_files("src/spi.c")
     
     add_files("src/state_machine.c") 
     add_files("src/cli.c")
+    add_files("src/i2c_cli.c")
     add_files("src/database.c")
+    add_files("src/journal.c")
+    add_files("src/kv.c")
     add_files("src/logic_filter.c")
     add_files("src/button.c")
 
     add_files("src/aw9523b.c")
     add_files("src/encoder.c")
     add_files("src/eeprom.c")
+    add_files("src/eeprom_sim.c")
     add_files("src/ir.c")
 
 target("example")
@@ -49,3 +59,72 @@ target("example")
     add_files("example/*.c")
     add_rules("map")
     add_cxflags("-Wall")
+
+target("test_database")
+    set_kind("binary")
+    set_group("test")
+    add_deps("mcu")
+    add_rules("mcu")
+    add_files("test/database.c")
+    add_cxflags("-Wall")
+
+target("test_i2c")
+    set_kind("binary")
+    set_group("test")
+    add_deps("mcu")
+    add_rules("mcu")
+    add_files("test/i2c.c")
+    add_cxflags("-Wall")
+
+target("test_kv")
+    set_kind("binary")
+    set_group("test")
+    add_deps("mcu")
+    add_rules("mcu")
+    add_files("test/kv.c")
+    add_cxflags("-Wall")
+
+target("test_journal")
+    set_kind("binary")
+    set_group("test")
+    add_deps("mcu")
+    add_rules("mcu")
+    add_files("test/journal.c")
+    add_cxflags("-Wall")
+
+target("test_memory_cache")
+    set_kind("binary")
+    set_group("test")
+    add_deps("mcu")
+    add_rules("mcu")
+    add_files("test/memory_cache.c")
+    add_cxflags("-Wall")
+
+target("bench_eeprom")
+    set_kind("binary")
+    set_group("bench")
+    add_deps("mcu")
+    add_rules("mcu")
+    add_files("bench/eeprom.c")
+    add_cxflags("-Wall")
+
+target("bench_i2c_soft")
+    set_kind("binary")
+    set_group("bench")
+    add_deps("mcu")
+    add_rules("mcu")
+    add_files("bench/i2c_soft.c")
+    add_cxflags("-Wall")
+
+for impl, name in pairs({ [0] = "bitwise", [1] = "table", [2] = "slice8" }) do
+    target("bench_crc_" .. name)
+        set_kind("binary")
+        set_group("bench")
+        set_optimize("fastest")
+        add_deps("mcu")
+        add_rules("mcu")
+        -- crc linked ahead of library to select implementation
+        add_files("bench/crc.c", "src/crc.c")
+        add_defines("WWS_CONFIG_CRC_IMPL=" .. impl)
+        add_cxflags("-Wall")
+end